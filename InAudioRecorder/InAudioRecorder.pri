@@ -6,12 +6,37 @@ HEADERS += ./resource.h \
     ./stdafx.h \
     ./inaudiorecorder.hpp \
     ./optionsdialog.hpp \
-    ./inaudiorecorderapplication.h
+    ./inaudiorecorderapplication.h \
+    ./recordsscanner.hpp \
+    ./wavformat.hpp \
+    ./diskmonitor.hpp \
+    ./controlserver.hpp \
+    ./archiveformat.hpp \
+    ./archivewriter.hpp \
+    ./archivereader.hpp \
+    ./syncrecorder.hpp \
+    ./syncrecorddialog.hpp \
+    ./syncstream.hpp \
+    ./bufferpool.hpp \
+    ./recordeditor.hpp
 SOURCES += ./inaudiorecorder.cpp \
     ./main.cpp \
     ./optionsdialog.cpp \
     ./stdafx.cpp \
-    ./inaudiorecorderapplication.cpp
+    ./inaudiorecorderapplication.cpp \
+    ./wavformat.cpp \
+    ./recordsscanner.cpp \
+    ./diskmonitor.cpp \
+    ./controlserver.cpp \
+    ./archiveformat.cpp \
+    ./archivewriter.cpp \
+    ./archivereader.cpp \
+    ./syncstream.cpp \
+    ./syncrecorder.cpp \
+    ./syncrecorddialog.cpp \
+    ./bufferpool.cpp \
+    ./recordeditor.cpp
 FORMS += ./inaudiorecorder.ui \
-    ./optionsdialog.ui
+    ./optionsdialog.ui \
+    ./syncrecorddialog.ui
 RESOURCES += inaudiorecorder.qrc
@@ -10,8 +10,8 @@ debug {
 release {
     DESTDIR = ../x64/Release
 }
-QT += core multimedia widgets gui
-DEFINES += QT_WIDGETS_LIB QT_MULTIMEDIA_LIB
+QT += core multimedia widgets gui concurrent network
+DEFINES += QT_WIDGETS_LIB QT_MULTIMEDIA_LIB QT_CONCURRENT_LIB QT_NETWORK_LIB
 CONFIG += precompile_header
 debug {
     CONFIG += console debug
@@ -0,0 +1,262 @@
+#include "stdafx.h"
+#include "archiveformat.hpp"
+#include "bufferpool.hpp"
+#include <cstring>
+
+namespace {
+    class BitWriter {
+    public:
+        BitWriter(QByteArray &_out) : out(_out), accumulator(0), count(0) {}
+
+        void write(std::uint32_t value, int bits) {
+            accumulator = (accumulator << bits) | (value & ((std::uint64_t(1) << bits) - 1));
+            count += bits;
+            while (count >= 8) {
+                count -= 8;
+                out.append(static_cast<char>(accumulator >> count));
+            }
+        }
+
+        void write_ones(int ones) {
+            for (; ones >= 16; ones -= 16)
+                this->write(0xFFFFu, 16);
+            this->write((std::uint32_t(1) << ones) - 1, ones);
+        }
+
+        void flush() {
+            if (count > 0)
+                out.append(static_cast<char>(accumulator << (8 - count)));
+            count = 0;
+        }
+    private:
+        QByteArray &out;
+        std::uint64_t accumulator;
+        int count;
+    };
+
+    class BitReader {
+    public:
+        BitReader(const uchar *_data, qint64 _size) : data(_data), size(_size), position(0) {}
+
+        bool read(int bits, std::uint32_t &value) {
+            if (position + bits > size * 8)
+                return false;
+            value = 0;
+            for (int i = 0; i < bits; ++i, ++position)
+                value = (value << 1) | ((data[position >> 3] >> (7 - (position & 7))) & 1);
+            return true;
+        }
+
+        //counts ones up to terminating zero, stops without consuming zero after limit ones
+        bool read_unary(int limit, std::uint32_t &ones) {
+            ones = 0;
+            while (ones < static_cast<std::uint32_t>(limit)) {
+                if (position >= size * 8)
+                    return false;
+                int bit = (data[position >> 3] >> (7 - (position & 7))) & 1;
+                ++position;
+                if (!bit)
+                    return true;
+                ++ones;
+            }
+            return true;
+        }
+    private:
+        const uchar *data;
+        qint64 size;
+        qint64 position;
+    };
+
+    template <typename T>
+    void append_le(QByteArray &out, T value) {
+        uchar bytes[sizeof(T)];
+        qToLittleEndian(value, bytes);
+        out.append(reinterpret_cast<const char*>(bytes), sizeof(T));
+    }
+}
+
+
+
+
+
+QByteArray ArchiveHeader::serialize() const {
+    QByteArray out;
+    out.reserve(HEADER_SIZE);
+    out.append(MAGIC, sizeof(MAGIC));
+    append_le(out, version);
+    append_le(out, channels);
+    append_le(out, sampleRate);
+    append_le(out, bitsPerSample);
+    append_le(out, blockFrames);
+    append_le(out, totalFrames);
+    append_le(out, startTimestamp);
+    quint32 bits;
+    std::memcpy(&bits, &loudness, sizeof(bits));
+    append_le(out, bits);
+    std::memcpy(&bits, &peak, sizeof(bits));
+    append_le(out, bits);
+    append_le(out, seekTableOffset);
+    append_le(out, metadataSize);
+    return out;
+}
+
+bool ArchiveHeader::parse(const uchar *data, qint64 size, ArchiveHeader &header) {
+    if (size < HEADER_SIZE || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0)
+        return false;
+    header.version = qFromLittleEndian<quint16>(data + 4);
+    header.channels = qFromLittleEndian<quint16>(data + 6);
+    header.sampleRate = qFromLittleEndian<quint32>(data + 8);
+    header.bitsPerSample = qFromLittleEndian<quint16>(data + 12);
+    header.blockFrames = qFromLittleEndian<quint16>(data + 14);
+    header.totalFrames = qFromLittleEndian<quint64>(data + 16);
+    header.startTimestamp = qFromLittleEndian<qint64>(data + 24);
+    quint32 bits = qFromLittleEndian<quint32>(data + 32);
+    std::memcpy(&header.loudness, &bits, sizeof(bits));
+    bits = qFromLittleEndian<quint32>(data + 36);
+    std::memcpy(&header.peak, &bits, sizeof(bits));
+    header.seekTableOffset = qFromLittleEndian<quint64>(data + 40);
+    header.metadataSize = qFromLittleEndian<quint32>(data + 48);
+    return header.version == VERSION && header.channels > 0 && header.blockFrames > 0 &&
+           HEADER_SIZE + static_cast<qint64>(header.metadataSize) <= size;
+}
+
+const char ArchiveHeader::MAGIC[4] = { 'I', 'A', 'R', 'C' };
+const quint16 ArchiveHeader::VERSION = 1;
+const int ArchiveHeader::HEADER_SIZE;
+const int ArchiveHeader::BLOCK_HEADER_SIZE;
+const int ArchiveHeader::SEEK_ENTRY_SIZE;
+const quint16 ArchiveHeader::DEFAULT_BLOCK_FRAMES = 4096;
+
+
+
+
+
+void ArchiveCodec::encode_block(const std::int32_t *samples, int frames, int channels, QByteArray &out) {
+    //scratch comes from pool, only oversized blocks allocate
+    PooledBuffer scratch = BufferPool::instance().acquire();
+    std::vector<std::uint32_t> fallback;
+    std::uint32_t *residuals = reinterpret_cast<std::uint32_t*>(scratch.data());
+    if (static_cast<qint64>(frames) * 4 > scratch.capacity()) {
+        fallback.resize(frames);
+        residuals = fallback.data();
+    }
+    for (int channel = 0; channel < channels; ++channel) {
+        const std::int32_t *channelSamples = samples + channel;
+        int order = std::min(ArchiveCodec::best_order(samples, frames, channels, channel), frames);
+
+        std::uint64_t sum = 0;
+        for (int i = order; i < frames; ++i) {
+            std::int64_t residual = channelSamples[i * channels] - ArchiveCodec::predict(channelSamples, i, channels, order);
+            std::uint32_t folded = static_cast<std::uint32_t>((static_cast<std::uint64_t>(residual) << 1) ^ static_cast<std::uint64_t>(residual >> 63)); //zigzag
+            residuals[i] = folded;
+            sum += folded;
+        }
+        int count = frames - order;
+        int parameter = 0;
+        while (parameter < 30 && (static_cast<std::uint64_t>(count) << parameter) < sum)
+            ++parameter;
+
+        out.append(static_cast<char>(order));
+        out.append(static_cast<char>(parameter));
+        for (int i = 0; i < order; ++i)
+            append_le(out, static_cast<qint32>(channelSamples[i * channels]));
+
+        int sizePosition = out.size();
+        append_le(out, quint32(0));
+        BitWriter writer(out);
+        for (int i = order; i < frames; ++i) {
+            std::uint32_t quotient = residuals[i] >> parameter;
+            if (quotient >= static_cast<std::uint32_t>(ESCAPE)) { //ESCAPE ones without terminator, then raw value
+                writer.write_ones(ESCAPE);
+                writer.write(residuals[i], 32);
+            } else {
+                writer.write_ones(static_cast<int>(quotient));
+                writer.write(0, 1);
+                if (parameter > 0)
+                    writer.write(residuals[i], parameter);
+            }
+        }
+        writer.flush();
+        qToLittleEndian(static_cast<quint32>(out.size() - sizePosition - 4),
+                        reinterpret_cast<uchar*>(out.data() + sizePosition));
+    }
+}
+
+bool ArchiveCodec::decode_block(const uchar *data, qint64 size, int frames, int channels, std::int32_t *samples) {
+    qint64 position = 0;
+    for (int channel = 0; channel < channels; ++channel) {
+        std::int32_t *channelSamples = samples + channel;
+        if (position + 2 > size)
+            return false;
+        int order = data[position];
+        int parameter = data[position + 1];
+        position += 2;
+        if (order > MAX_ORDER || order > frames || parameter > 30 || position + 4 * order + 4 > size)
+            return false;
+        for (int i = 0; i < order; ++i, position += 4)
+            channelSamples[i * channels] = qFromLittleEndian<qint32>(data + position);
+
+        quint32 bytes = qFromLittleEndian<quint32>(data + position);
+        position += 4;
+        if (position + bytes > size)
+            return false;
+        BitReader reader(data + position, bytes);
+        for (int i = order; i < frames; ++i) {
+            std::uint32_t quotient, remainder = 0, folded;
+            if (!reader.read_unary(ESCAPE, quotient))
+                return false;
+            if (quotient == static_cast<std::uint32_t>(ESCAPE)) {
+                if (!reader.read(32, folded))
+                    return false;
+            } else {
+                if (parameter > 0 && !reader.read(parameter, remainder))
+                    return false;
+                folded = (quotient << parameter) | remainder;
+            }
+            std::int64_t residual = static_cast<std::int64_t>(folded >> 1) ^ -static_cast<std::int64_t>(folded & 1);
+            channelSamples[i * channels] = static_cast<std::int32_t>(
+                ArchiveCodec::predict(channelSamples, i, channels, order) + residual
+            );
+        }
+        position += bytes;
+    }
+    return true;
+}
+
+
+
+
+
+int ArchiveCodec::best_order(const std::int32_t *samples, int frames, int channels, int channel) {
+    //fixed polynomial predictors like FLAC, pick the one with smallest absolute residual sum
+    const std::int32_t *channelSamples = samples + channel;
+    int best = 0;
+    std::uint64_t bestSum = UINT64_MAX;
+    for (int order = 0; order <= MAX_ORDER; ++order) {
+        std::uint64_t sum = 0;
+        for (int i = MAX_ORDER; i < frames; ++i) {
+            std::int64_t residual = channelSamples[i * channels] - ArchiveCodec::predict(channelSamples, i, channels, order);
+            sum += static_cast<std::uint64_t>(residual < 0 ? -residual : residual);
+        }
+        if (sum < bestSum) {
+            bestSum = sum;
+            best = order;
+        }
+    }
+    return best;
+}
+
+std::int64_t ArchiveCodec::predict(const std::int32_t *samples, int index, int channels, int order) {
+    const std::int64_t a = order >= 1 ? samples[(index - 1) * channels] : 0;
+    const std::int64_t b = order >= 2 ? samples[(index - 2) * channels] : 0;
+    const std::int64_t c = order >= 3 ? samples[(index - 3) * channels] : 0;
+    switch (order) {
+    case 1: return a;
+    case 2: return 2 * a - b;
+    case 3: return 3 * a - 3 * b + c;
+    default: return 0;
+    }
+}
+
+const int ArchiveCodec::MAX_ORDER = 3;
+const int ArchiveCodec::ESCAPE = 24;
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <vector>
+#include <cstdint>
+
+//InAudioRecorder archive (.iar) layout, all numbers little endian:
+//  header        HEADER_SIZE bytes, fields below, patched when writer finishes
+//  metadata      metadataSize bytes of compact JSON
+//  blocks        [u32 payload size][u16 frames][u16 reserved][payload]
+//  seek table    [u32 count][u64 first frame, u64 block offset] * count
+//Every block payload holds one section per channel:
+//  [u8 predictor order][u8 rice parameter][i32 warmup * order][u32 bytes][rice coded residuals]
+struct ArchiveHeader {
+    quint16 version;
+    quint16 channels;
+    quint32 sampleRate;
+    quint16 bitsPerSample;      //16 or 24, samples are decoded into int32
+    quint16 blockFrames;
+    quint64 totalFrames;
+    qint64 startTimestamp;      //msecs since epoch
+    float loudness;             //integrated RMS in dBFS
+    float peak;                 //dBFS
+    quint64 seekTableOffset;
+    quint32 metadataSize;
+
+    QByteArray serialize() const;
+    static bool parse(const uchar *data, qint64 size, ArchiveHeader &header);
+
+    static const char MAGIC[4];
+    static const quint16 VERSION;
+    static const int HEADER_SIZE = 52;
+    static const int BLOCK_HEADER_SIZE = 8;
+    static const int SEEK_ENTRY_SIZE = 16;
+    static const quint16 DEFAULT_BLOCK_FRAMES;
+};
+
+class ArchiveCodec {
+public:
+    //samples are interleaved, block must contain frames * channels values
+    static void encode_block(const std::int32_t *samples, int frames, int channels, QByteArray &out);
+    static bool decode_block(const uchar *data, qint64 size, int frames, int channels, std::int32_t *samples);
+private:
+    static int best_order(const std::int32_t *samples, int frames, int channels, int channel);
+    static std::int64_t predict(const std::int32_t *samples, int index, int channels, int order);
+
+    static const int MAX_ORDER;
+    static const int ESCAPE;
+};
@@ -0,0 +1,193 @@
+#include "stdafx.h"
+#include "archivereader.hpp"
+
+ArchiveReader::ArchiveReader()
+    : file()
+    , data(nullptr)
+    , size(0)
+    , header()
+    , seekTable(nullptr)
+    , recoveredTable()
+    , blocks(0)
+    , currentBlock(0)
+    , decoded()
+    , decodedFrames(0)
+    , framePosition(0) {}
+
+ArchiveReader::~ArchiveReader() {
+    this->close();
+}
+
+bool ArchiveReader::open(const QString &path) {
+    this->close();
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    size = file.size();
+    data = file.map(0, size);
+    if (data == nullptr || !ArchiveHeader::parse(data, size, header)) {
+        this->close();
+        return false;
+    }
+
+    if (header.seekTableOffset == 0) { //unfinished archive, writer did not close it
+        if (!this->recover()) {
+            this->close();
+            return false;
+        }
+    } else {
+        if (header.seekTableOffset < static_cast<quint64>(ArchiveHeader::HEADER_SIZE) ||
+            header.seekTableOffset + 4 > static_cast<quint64>(size)) {
+            this->close();
+            return false;
+        }
+        blocks = qFromLittleEndian<quint32>(data + header.seekTableOffset);
+        seekTable = data + header.seekTableOffset + 4;
+        if (header.seekTableOffset + 4 + blocks * ArchiveHeader::SEEK_ENTRY_SIZE > static_cast<quint64>(size)) {
+            this->close();
+            return false;
+        }
+    }
+
+    decoded.assign(static_cast<std::size_t>(header.blockFrames) * header.channels, 0);
+    currentBlock = blocks;
+    decodedFrames = 0;
+    framePosition = 0;
+    return true;
+}
+
+void ArchiveReader::close() {
+    if (data != nullptr)
+        file.unmap(const_cast<uchar*>(data));
+    file.close();
+    data = nullptr;
+    seekTable = nullptr;
+    recoveredTable.clear();
+    size = 0;
+    blocks = 0;
+}
+
+const ArchiveHeader &ArchiveReader::get_header() const {
+    return header;
+}
+
+QJsonObject ArchiveReader::get_metadata() const {
+    if (data == nullptr)
+        return QJsonObject();
+    QByteArray json = QByteArray::fromRawData(
+        reinterpret_cast<const char*>(data + ArchiveHeader::HEADER_SIZE),
+        static_cast<int>(header.metadataSize)
+    );
+    return QJsonDocument::fromJson(json).object();
+}
+
+bool ArchiveReader::is_recovered() const {
+    return !recoveredTable.empty();
+}
+
+quint64 ArchiveReader::block_count() const {
+    return blocks;
+}
+
+quint64 ArchiveReader::block_frame(quint64 index) const {
+    return qFromLittleEndian<quint64>(seekTable + index * ArchiveHeader::SEEK_ENTRY_SIZE);
+}
+
+quint64 ArchiveReader::block_offset(quint64 index) const {
+    return qFromLittleEndian<quint64>(seekTable + index * ArchiveHeader::SEEK_ENTRY_SIZE + 8);
+}
+
+
+
+
+
+bool ArchiveReader::seek(quint64 frame) {
+    if (data == nullptr || frame > header.totalFrames)
+        return false;
+    framePosition = frame;
+    return true;
+}
+
+quint64 ArchiveReader::position() const {
+    return framePosition;
+}
+
+qint64 ArchiveReader::read(std::int32_t *samples, qint64 frames) {
+    if (data == nullptr)
+        return -1;
+
+    qint64 done = 0;
+    while (done < frames && framePosition < header.totalFrames && blocks > 0) {
+        //last block with first frame <= position
+        quint64 low = 0, high = blocks;
+        while (high - low > 1) {
+            quint64 middle = low + (high - low) / 2;
+            if (this->block_frame(middle) <= framePosition)
+                low = middle;
+            else
+                high = middle;
+        }
+        if (low != currentBlock && !this->load_block(low))
+            return done > 0 ? done : -1;
+
+        quint64 offset = framePosition - this->block_frame(low);
+        if (offset >= static_cast<quint64>(decodedFrames))
+            break;
+        qint64 count = std::min<qint64>(frames - done, decodedFrames - static_cast<qint64>(offset));
+        std::copy_n(
+            decoded.begin() + static_cast<std::ptrdiff_t>(offset * header.channels),
+            count * header.channels,
+            samples + done * header.channels
+        );
+        done += count;
+        framePosition += static_cast<quint64>(count);
+    }
+    return done;
+}
+
+bool ArchiveReader::recover() {
+    //walk block headers from the first block, stop at first truncated or invalid one
+    quint64 offset = static_cast<quint64>(ArchiveHeader::HEADER_SIZE) + header.metadataSize;
+    quint64 frame = 0;
+    std::vector<std::pair<quint64, quint64>> found;
+    while (offset + ArchiveHeader::BLOCK_HEADER_SIZE <= static_cast<quint64>(size)) {
+        quint32 payload = qFromLittleEndian<quint32>(data + offset);
+        int frames = qFromLittleEndian<quint16>(data + offset + 4);
+        if (frames == 0 || frames > header.blockFrames ||
+            offset + ArchiveHeader::BLOCK_HEADER_SIZE + payload > static_cast<quint64>(size))
+            break;
+        found.emplace_back(frame, offset);
+        frame += static_cast<quint64>(frames);
+        offset += ArchiveHeader::BLOCK_HEADER_SIZE + payload;
+    }
+    if (found.empty())
+        return false;
+
+    recoveredTable.resize(found.size() * ArchiveHeader::SEEK_ENTRY_SIZE);
+    uchar *entry = recoveredTable.data();
+    for (auto &x : found) {
+        qToLittleEndian(x.first, entry);
+        qToLittleEndian(x.second, entry + 8);
+        entry += ArchiveHeader::SEEK_ENTRY_SIZE;
+    }
+    seekTable = recoveredTable.data();
+    blocks = found.size();
+    header.totalFrames = frame;
+    header.seekTableOffset = offset;    //blocks end here, table is written there when archive is edited
+    return true;
+}
+
+bool ArchiveReader::load_block(quint64 index) {
+    quint64 offset = this->block_offset(index);
+    if (offset + ArchiveHeader::BLOCK_HEADER_SIZE > header.seekTableOffset)
+        return false;
+    quint32 payload = qFromLittleEndian<quint32>(data + offset);
+    int frames = qFromLittleEndian<quint16>(data + offset + 4);
+    if (frames > header.blockFrames || offset + ArchiveHeader::BLOCK_HEADER_SIZE + payload > header.seekTableOffset)
+        return false;
+    if (!ArchiveCodec::decode_block(data + offset + ArchiveHeader::BLOCK_HEADER_SIZE, payload, frames, header.channels, decoded.data()))
+        return false;
+    currentBlock = index;
+    decodedFrames = frames;
+    return true;
+}
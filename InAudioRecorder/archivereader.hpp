@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QFile>
+#include "archiveformat.hpp"
+
+//reads archive through memory mapping, seeking is a binary search over the seek table
+//archive left without seek table by a crash is read by scanning its block headers
+class ArchiveReader {
+public:
+    ArchiveReader();
+    ~ArchiveReader();
+
+    bool open(const QString &path);
+    void close();
+
+    const ArchiveHeader &get_header() const;
+    bool is_recovered() const;                          //seek table was rebuilt from blocks of unfinished archive
+    QJsonObject get_metadata() const;
+    quint64 block_count() const;
+    quint64 block_frame(quint64 index) const;
+    quint64 block_offset(quint64 index) const;
+
+    bool seek(quint64 frame);
+    quint64 position() const;
+    qint64 read(std::int32_t *samples, qint64 frames);  //interleaved, returns frames read
+private:
+    bool recover();
+    bool load_block(quint64 index);
+
+    QFile file;
+    const uchar *data;
+    qint64 size;
+    ArchiveHeader header;
+    const uchar *seekTable;
+    std::vector<uchar> recoveredTable;
+    quint64 blocks;
+    quint64 currentBlock;
+    std::vector<std::int32_t> decoded;
+    int decodedFrames;
+    quint64 framePosition;
+};
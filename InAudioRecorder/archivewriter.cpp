@@ -0,0 +1,175 @@
+#include "stdafx.h"
+#include "archivewriter.hpp"
+#include <cmath>
+#include <cstring>
+
+ArchiveWriter::ArchiveWriter()
+    : file()
+    , header{ ArchiveHeader::VERSION, 0, 0, 0, ArchiveHeader::DEFAULT_BLOCK_FRAMES, 0, 0, 0.0f, 0.0f, 0, 0 }
+    , metadata()
+    , format()
+    , block()
+    , seekTable()
+    , encoded()
+    , blockFill(0)
+    , sumSquares(0.0)
+    , peak(0.0)
+    , started(false) {}
+
+ArchiveWriter::~ArchiveWriter() {
+    this->close();
+}
+
+bool ArchiveWriter::open(const QString &path, const QJsonObject &_metadata, qint64 startTimestamp) {
+    this->close();
+    file.setFileName(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    metadata = QJsonDocument(_metadata).toJson(QJsonDocument::Compact);
+    header.startTimestamp = startTimestamp;
+    header.metadataSize = static_cast<quint32>(metadata.size());
+    header.totalFrames = 0;
+    seekTable.clear();
+    blockFill = 0;
+    sumSquares = 0.0;
+    peak = 0.0;
+    started = false;
+    return true;
+}
+
+bool ArchiveWriter::write(const QAudioBuffer &buffer) {
+    if (!file.isOpen() || !buffer.isValid())
+        return false;
+    if (!started && !this->start(buffer.format())) {
+        file.remove(); //unsupported sample format, nothing useful was written
+        return false;
+    }
+    if (buffer.format() != format) //format can not change inside one archive
+        return false;
+    return this->convert(buffer);
+}
+
+bool ArchiveWriter::close() {
+    if (!file.isOpen())
+        return false;
+
+    bool ok = true;
+    if (started) {
+        ok = this->flush_block();
+
+        header.seekTableOffset = static_cast<quint64>(file.pos());
+        QByteArray table;
+        table.reserve(4 + ArchiveHeader::SEEK_ENTRY_SIZE * static_cast<int>(seekTable.size()));
+        uchar entry[ArchiveHeader::SEEK_ENTRY_SIZE];
+        qToLittleEndian(static_cast<quint32>(seekTable.size()), entry);
+        table.append(reinterpret_cast<const char*>(entry), 4);
+        for (auto &x : seekTable) {
+            qToLittleEndian(x.first, entry);
+            qToLittleEndian(x.second, entry + 8);
+            table.append(reinterpret_cast<const char*>(entry), ArchiveHeader::SEEK_ENTRY_SIZE);
+        }
+        ok = ok && file.write(table) == table.size();
+
+        qint64 samples = static_cast<qint64>(header.totalFrames) * header.channels;
+        header.loudness = samples > 0 && sumSquares > 0.0 ? static_cast<float>(10.0 * std::log10(sumSquares / samples)) : -120.0f;
+        header.peak = peak > 0.0 ? static_cast<float>(20.0 * std::log10(peak)) : -120.0f;
+        ok = ok && file.seek(0) && file.write(header.serialize()) == ArchiveHeader::HEADER_SIZE;
+    }
+    file.close();
+    started = false;
+    return ok;
+}
+
+bool ArchiveWriter::is_open() const {
+    return file.isOpen();
+}
+
+QString ArchiveWriter::file_name() const {
+    return file.fileName();
+}
+
+
+
+
+
+bool ArchiveWriter::start(const QAudioFormat &_format) {
+    if (_format.channelCount() <= 0 || _format.sampleRate() <= 0)
+        return false;
+    bool narrow = _format.sampleSize() <= 16 && _format.sampleType() != QAudioFormat::Float;
+    if (_format.sampleSize() != 8 && _format.sampleSize() != 16 && _format.sampleSize() != 32)
+        return false;
+
+    format = _format;
+    header.channels = static_cast<quint16>(format.channelCount());
+    header.sampleRate = static_cast<quint32>(format.sampleRate());
+    header.bitsPerSample = narrow ? 16 : 24;
+    block.assign(static_cast<std::size_t>(header.blockFrames) * header.channels, 0);
+    //reserved capacity survives resize(0), blocks are encoded without reallocating
+    encoded.reserve(ArchiveHeader::BLOCK_HEADER_SIZE + header.blockFrames * header.channels * 4);
+
+    //final values are patched in close()
+    if (file.write(header.serialize()) != ArchiveHeader::HEADER_SIZE || file.write(metadata) != metadata.size())
+        return false;
+    started = true;
+    return true;
+}
+
+bool ArchiveWriter::convert(const QAudioBuffer &buffer) {
+    const int channels = header.channels;
+    const int bytes = format.bytesPerFrame() / channels;
+    const bool bigEndian = format.byteOrder() == QAudioFormat::BigEndian;
+    const double scale = header.bitsPerSample == 16 ? 32768.0 : 8388608.0;
+    const uchar *data = static_cast<const uchar*>(buffer.constData());
+
+    for (int frame = 0; frame < buffer.frameCount(); ++frame) {
+        for (int channel = 0; channel < channels; ++channel, data += bytes) {
+            std::int32_t value;
+            switch (bytes) {
+            case 1:
+                value = format.sampleType() == QAudioFormat::UnSignedInt ? (data[0] - 128) << 8 : static_cast<qint8>(data[0]) << 8;
+                break;
+            case 2: {
+                quint16 raw = bigEndian ? qFromBigEndian<quint16>(data) : qFromLittleEndian<quint16>(data);
+                value = format.sampleType() == QAudioFormat::UnSignedInt ? raw - 32768 : static_cast<qint16>(raw);
+                break;
+            }
+            default: {
+                quint32 raw = bigEndian ? qFromBigEndian<quint32>(data) : qFromLittleEndian<quint32>(data);
+                if (format.sampleType() == QAudioFormat::Float) {
+                    float sample;
+                    std::memcpy(&sample, &raw, sizeof(sample));
+                    value = static_cast<std::int32_t>(std::lround(qBound(-1.0f, sample, 1.0f) * 8388607.0f));
+                } else if (format.sampleType() == QAudioFormat::UnSignedInt)
+                    value = static_cast<std::int32_t>((raw >> 8) - 8388608u);
+                else
+                    value = static_cast<qint32>(raw) >> 8;
+            }
+            }
+            double normalized = value / scale;
+            sumSquares += normalized * normalized;
+            peak = std::max(peak, std::abs(normalized));
+            block[static_cast<std::size_t>(blockFill) * channels + channel] = value;
+        }
+        if (++blockFill == header.blockFrames && !this->flush_block())
+            return false;
+    }
+    return true;
+}
+
+bool ArchiveWriter::flush_block() {
+    if (blockFill == 0)
+        return true;
+
+    encoded.resize(0);
+    uchar blockHeader[ArchiveHeader::BLOCK_HEADER_SIZE] = {};
+    encoded.append(reinterpret_cast<const char*>(blockHeader), ArchiveHeader::BLOCK_HEADER_SIZE);
+    ArchiveCodec::encode_block(block.data(), blockFill, header.channels, encoded);
+    qToLittleEndian(static_cast<quint32>(encoded.size() - ArchiveHeader::BLOCK_HEADER_SIZE), blockHeader);
+    qToLittleEndian(static_cast<quint16>(blockFill), blockHeader + 4);
+    std::memcpy(encoded.data(), blockHeader, ArchiveHeader::BLOCK_HEADER_SIZE);
+
+    seekTable.emplace_back(header.totalFrames, static_cast<quint64>(file.pos()));
+    header.totalFrames += static_cast<quint64>(blockFill);
+    blockFill = 0;
+    return file.write(encoded) == encoded.size();
+}
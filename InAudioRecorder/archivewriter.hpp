@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QFile>
+#include <QAudioBuffer>
+#include "archiveformat.hpp"
+
+//8 and 16-bit input is stored exactly, 32-bit integer and float input is quantized to 24 bits
+class ArchiveWriter {
+public:
+    ArchiveWriter();
+    ~ArchiveWriter();
+
+    bool open(const QString &path, const QJsonObject &metadata, qint64 startTimestamp);
+    bool write(const QAudioBuffer &buffer);
+    bool close();
+
+    bool is_open() const;
+    QString file_name() const;
+private:
+    bool start(const QAudioFormat &format);
+    bool convert(const QAudioBuffer &buffer);
+    bool flush_block();
+
+    QFile file;
+    ArchiveHeader header;
+    QByteArray metadata;
+    QAudioFormat format;
+    std::vector<std::int32_t> block;
+    std::vector<std::pair<quint64, quint64>> seekTable;   //first frame, block offset
+    QByteArray encoded;
+    int blockFill;
+    double sumSquares;
+    double peak;
+    bool started;
+};
@@ -0,0 +1,194 @@
+#include "stdafx.h"
+#include "bufferpool.hpp"
+
+BufferPool &BufferPool::instance() {
+    //never destroyed, thread caches of late threads may still return blocks
+    static BufferPool *pool = new BufferPool();
+    return *pool;
+}
+
+PooledBuffer BufferPool::acquire() {
+    ThreadCache &cache = BufferPool::thread_cache();
+    Block *block = cache.count > 0 ? cache.blocks[--cache.count] : this->pop();
+    if (block == nullptr)
+        block = this->grow();
+    if (block == nullptr)
+        return PooledBuffer();
+
+    block->references.store(1, std::memory_order_relaxed);
+    block->size = 0;
+    inUse.fetch_add(1, std::memory_order_relaxed);
+    acquires.fetch_add(1, std::memory_order_relaxed);
+    return PooledBuffer(block);
+}
+
+BufferPool::Statistics BufferPool::get_statistics() const {
+    qint64 segments = segmentCount.load(std::memory_order_relaxed);
+    return Statistics{
+        segments * SEGMENT_BLOCKS,
+        inUse.load(std::memory_order_relaxed),
+        segments,
+        acquires.load(std::memory_order_relaxed)
+    };
+}
+
+
+
+
+
+BufferPool::ThreadCache::ThreadCache()
+    : blocks()
+    , count(0) {}
+
+BufferPool::ThreadCache::~ThreadCache() {
+    BufferPool &pool = BufferPool::instance();
+    while (count > 0)
+        pool.push(blocks[--count]);
+}
+
+BufferPool::BufferPool()
+    : segments()
+    , freeHead(0)
+    , inUse(0)
+    , acquires(0)
+    , segmentCount(0)
+    , growMutex() {
+    for (auto &x : segments)
+        x.store(nullptr, std::memory_order_relaxed);
+}
+
+BufferPool::~BufferPool() {}
+
+BufferPool::Block *BufferPool::pop() {
+    quint64 head = freeHead.load(std::memory_order_acquire);
+    while (true) {
+        quint32 top = static_cast<quint32>(head);
+        if (top == 0)
+            return nullptr;
+        //blocks are never freed, reading next of a block popped meanwhile is harmless, tag makes CAS fail
+        Block *block = this->block_at(top - 1);
+        quint64 next = block->next.load(std::memory_order_relaxed);
+        quint64 desired = (((head >> 32) + 1) << 32) | next;
+        if (freeHead.compare_exchange_weak(head, desired, std::memory_order_acq_rel, std::memory_order_acquire))
+            return block;
+    }
+}
+
+void BufferPool::push(Block *block) {
+    quint64 head = freeHead.load(std::memory_order_relaxed);
+    quint64 desired;
+    do {
+        block->next.store(static_cast<quint32>(head), std::memory_order_relaxed);
+        desired = (((head >> 32) + 1) << 32) | (block->index + 1);
+    } while (!freeHead.compare_exchange_weak(head, desired, std::memory_order_release, std::memory_order_relaxed));
+}
+
+BufferPool::Block *BufferPool::grow() {
+    std::lock_guard<std::mutex> lock(growMutex);
+    Block *block = this->pop(); //other thread may have grown pool already
+    if (block != nullptr)
+        return block;
+
+    int segment = segmentCount.load(std::memory_order_relaxed);
+    if (segment == MAX_SEGMENTS)
+        return nullptr;
+
+    Block *blocks = new Block[SEGMENT_BLOCKS];
+    char *memory = new char[static_cast<std::size_t>(SEGMENT_BLOCKS) * BLOCK_SIZE];
+    for (int i = 0; i < SEGMENT_BLOCKS; ++i) {
+        blocks[i].references.store(0, std::memory_order_relaxed);
+        blocks[i].next.store(0, std::memory_order_relaxed);
+        blocks[i].index = static_cast<quint32>(segment * SEGMENT_BLOCKS + i);
+        blocks[i].size = 0;
+        blocks[i].data = memory + static_cast<std::size_t>(i) * BLOCK_SIZE;
+    }
+    segments[segment].store(blocks, std::memory_order_release);
+    segmentCount.store(segment + 1, std::memory_order_relaxed);
+
+    for (int i = 1; i < SEGMENT_BLOCKS; ++i)
+        this->push(&blocks[i]);
+    return &blocks[0];
+}
+
+BufferPool::Block *BufferPool::block_at(quint32 index) const {
+    return segments[index / SEGMENT_BLOCKS].load(std::memory_order_acquire) + index % SEGMENT_BLOCKS;
+}
+
+void BufferPool::release(Block *block) {
+    inUse.fetch_sub(1, std::memory_order_relaxed);
+    ThreadCache &cache = BufferPool::thread_cache();
+    if (cache.count < CACHE_SIZE)
+        cache.blocks[cache.count++] = block;
+    else
+        this->push(block);
+}
+
+BufferPool::ThreadCache &BufferPool::thread_cache() {
+    static thread_local ThreadCache cache;
+    return cache;
+}
+
+const int BufferPool::BLOCK_SIZE;
+const int BufferPool::SEGMENT_BLOCKS;
+const int BufferPool::MAX_SEGMENTS;
+const int BufferPool::CACHE_SIZE;
+
+
+
+
+
+PooledBuffer::PooledBuffer()
+    : block(nullptr) {}
+
+PooledBuffer::PooledBuffer(BufferPool::Block *_block)
+    : block(_block) {}
+
+PooledBuffer::PooledBuffer(const PooledBuffer &other)
+    : block(other.block) {
+    if (block != nullptr)
+        block->references.fetch_add(1, std::memory_order_relaxed);
+}
+
+PooledBuffer::PooledBuffer(PooledBuffer &&other)
+    : block(other.block) {
+    other.block = nullptr;
+}
+
+PooledBuffer &PooledBuffer::operator=(PooledBuffer other) {
+    std::swap(block, other.block);
+    return *this;
+}
+
+PooledBuffer::~PooledBuffer() {
+    if (block != nullptr && block->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        BufferPool::instance().release(block);
+}
+
+bool PooledBuffer::is_null() const {
+    return block == nullptr;
+}
+
+bool PooledBuffer::is_shared() const {
+    return block != nullptr && block->references.load(std::memory_order_acquire) > 1;
+}
+
+char *PooledBuffer::data() {
+    return block != nullptr ? block->data : nullptr;
+}
+
+const char *PooledBuffer::data() const {
+    return block != nullptr ? block->data : nullptr;
+}
+
+int PooledBuffer::size() const {
+    return block != nullptr ? block->size : 0;
+}
+
+void PooledBuffer::set_size(int size) {
+    if (block != nullptr)
+        block->size = qBound(0, size, BufferPool::BLOCK_SIZE);
+}
+
+int PooledBuffer::capacity() const {
+    return block != nullptr ? BufferPool::BLOCK_SIZE : 0;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <QtGlobal>
+#include <atomic>
+#include <mutex>
+
+class PooledBuffer;
+
+//fixed size blocks shared by all audio stages, memory is allocated in segments and never returned to the system
+class BufferPool {
+public:
+    struct Statistics {
+        qint64 blocks;          //allocated
+        qint64 inUse;
+        qint64 segments;        //heap allocations done by pool
+        qint64 acquires;
+    };
+
+    static BufferPool &instance();
+
+    PooledBuffer acquire();
+    Statistics get_statistics() const;
+
+    static const int BLOCK_SIZE = 64 * 1024;
+private:
+    friend class PooledBuffer;
+
+    struct Block {
+        std::atomic<int> references;
+        std::atomic<quint32> next;  //free list link, index + 1, 0 ends list
+        quint32 index;
+        int size;
+        char *data;
+    };
+
+    struct ThreadCache {
+        ThreadCache();
+        ~ThreadCache();
+        Block *blocks[16];
+        int count;
+    };
+
+    BufferPool();
+    ~BufferPool();
+
+    Block *pop();
+    void push(Block *block);
+    Block *grow();
+    Block *block_at(quint32 index) const;
+    void release(Block *block);
+
+    static ThreadCache &thread_cache();
+
+    std::atomic<Block*> segments[256];
+    std::atomic<quint64> freeHead;  //tag in high half against ABA, index + 1 in low half
+    std::atomic<qint64> inUse;
+    std::atomic<qint64> acquires;
+    std::atomic<int> segmentCount;
+    std::mutex growMutex;
+
+    static const int SEGMENT_BLOCKS = 16;
+    static const int MAX_SEGMENTS = 256;
+    static const int CACHE_SIZE = 16;
+};
+
+//reference counted handle, the last copy gives block back to pool
+class PooledBuffer {
+public:
+    PooledBuffer();
+    PooledBuffer(const PooledBuffer &other);
+    PooledBuffer(PooledBuffer &&other);
+    PooledBuffer &operator=(PooledBuffer other);
+    ~PooledBuffer();
+
+    bool is_null() const;
+    bool is_shared() const;
+    char *data();
+    const char *data() const;
+    int size() const;
+    void set_size(int size);
+    int capacity() const;
+private:
+    friend class BufferPool;
+    explicit PooledBuffer(BufferPool::Block *block);
+
+    BufferPool::Block *block;
+};
@@ -0,0 +1,81 @@
+#include "stdafx.h"
+#include "controlserver.hpp"
+
+ControlServer::ControlServer(const QString &_name, const Handler &_handler, QObject *parent)
+    : QObject(parent)
+    , server(new QLocalServer(this))
+    , name(_name)
+    , handler(_handler) {
+    server->setSocketOptions(QLocalServer::UserAccessOption);
+    QObject::connect(server, &QLocalServer::newConnection, this, &ControlServer::new_connection);
+}
+
+ControlServer::~ControlServer() {}
+
+bool ControlServer::listen() {
+    //socket left by crashed instance, single instance is already guaranteed by caller
+    QLocalServer::removeServer(name);
+    return server->listen(name);
+}
+
+QString ControlServer::error_string() const {
+    return server->errorString();
+}
+
+QJsonObject ControlServer::send(const QString &name, const QJsonObject &request, int timeout) {
+    QLocalSocket socket;
+    socket.connectToServer(name);
+    if (!socket.waitForConnected(timeout))
+        return ControlServer::error_reply("Could not connect to running instance: " + socket.errorString());
+
+    socket.write(QJsonDocument(request).toJson(QJsonDocument::Compact) + '\n');
+    if (!socket.waitForBytesWritten(timeout))
+        return ControlServer::error_reply("Could not send command: " + socket.errorString());
+    while (!socket.canReadLine())
+        if (!socket.waitForReadyRead(timeout))
+            return ControlServer::error_reply("No reply from running instance: " + socket.errorString());
+
+    QJsonParseError error;
+    QJsonDocument reply = QJsonDocument::fromJson(socket.readLine(), &error);
+    if (error.error != QJsonParseError::NoError || !reply.isObject())
+        return ControlServer::error_reply("Invalid reply from running instance");
+    return reply.object();
+}
+
+QJsonObject ControlServer::error_reply(const QString &message) {
+    return QJsonObject{ { "ok", false }, { "error", message } };
+}
+
+
+
+
+
+void ControlServer::new_connection() {
+    while (QLocalSocket *socket = server->nextPendingConnection()) {
+        QObject::connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+        QObject::connect(socket, &QLocalSocket::readyRead, this, [this, socket] {
+            this->read_requests(socket);
+        });
+    }
+}
+
+void ControlServer::read_requests(QLocalSocket *socket) {
+    //connections are kept open so that clients can pipeline many commands
+    while (socket->canReadLine()) {
+        QByteArray line = socket->readLine();
+        QJsonParseError error;
+        QJsonDocument request = QJsonDocument::fromJson(line, &error);
+        QJsonObject reply;
+        if (error.error != QJsonParseError::NoError || !request.isObject())
+            reply = ControlServer::error_reply("Invalid request: " + error.errorString());
+        else
+            reply = handler(request.object());
+        socket->write(QJsonDocument(reply).toJson(QJsonDocument::Compact) + '\n');
+    }
+    if (socket->bytesAvailable() > MAX_REQUEST_SIZE) {
+        socket->abort();
+        socket->deleteLater();
+    }
+}
+
+const qint64 ControlServer::MAX_REQUEST_SIZE = 64 * 1024;
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <QObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QJsonObject>
+#include <functional>
+
+//line based protocol, every request and reply is a single compact JSON object followed by '\n'
+class ControlServer : public QObject {
+    Q_OBJECT
+public:
+    using Handler = std::function<QJsonObject(const QJsonObject &request)>;
+
+    ControlServer(const QString &name, const Handler &handler, QObject *parent = nullptr);
+    ~ControlServer();
+
+    bool listen();
+    QString error_string() const;
+
+    static QJsonObject send(const QString &name, const QJsonObject &request, int timeout = 5000);
+    static QJsonObject error_reply(const QString &message);
+private slots:
+    void new_connection();
+private:
+    void read_requests(QLocalSocket *socket);
+
+    QLocalServer *server;
+    QString name;
+    Handler handler;
+
+    static const qint64 MAX_REQUEST_SIZE;
+};
@@ -0,0 +1,116 @@
+#include "stdafx.h"
+#include "diskmonitor.hpp"
+
+DiskMonitor::DiskMonitor(QObject *parent)
+    : QObject(parent)
+    , timer(new QTimer(this))
+    , clock()
+    , storage()
+    , filePath()
+    , thresholds{ 600, 180, 30, 50ll * 1024 * 1024 }
+    , level(Normal)
+    , lastSize(0)
+    , lastCheck(0)
+    , freeBytes(-1)
+    , rate(0.0) {
+    timer->setInterval(INTERVAL);
+    QObject::connect(timer, &QTimer::timeout, this, &DiskMonitor::check);
+}
+
+DiskMonitor::~DiskMonitor() {}
+
+void DiskMonitor::set_thresholds(const Thresholds &_thresholds) {
+    thresholds = _thresholds;
+}
+
+const DiskMonitor::Thresholds &DiskMonitor::get_thresholds() const {
+    return thresholds;
+}
+
+void DiskMonitor::start(const QString &_filePath) {
+    filePath = _filePath;
+    storage.setPath(QFileInfo(filePath).absolutePath());
+    freeBytes = storage.bytesAvailable();
+    level = Normal;
+    lastSize = QFileInfo(filePath).size();
+    lastCheck = 0;
+    rate = 0.0;
+    clock.start();
+    timer->start();
+}
+
+void DiskMonitor::stop() {
+    timer->stop();
+    filePath.clear();
+    level = Normal;
+    rate = 0.0;
+}
+
+bool DiskMonitor::has_space(const QString &directory) const {
+    QStorageInfo info(directory);
+    return !info.isValid() || info.bytesAvailable() >= thresholds.minimumFreeBytes;
+}
+
+
+
+
+
+double DiskMonitor::bytes_per_second() const {
+    return rate;
+}
+
+qint64 DiskMonitor::free_bytes() const {
+    return freeBytes;
+}
+
+qint64 DiskMonitor::seconds_left() const {
+    if (rate < 1.0)
+        return -1;
+    return static_cast<qint64>(std::max<qint64>(freeBytes - thresholds.minimumFreeBytes, 0) / rate);
+}
+
+
+
+
+
+void DiskMonitor::check() {
+    //one stat() of the output file and one statvfs() of its filesystem per tick
+    qint64 size = QFileInfo(filePath).size();
+    storage.refresh();
+    freeBytes = storage.bytesAvailable();
+
+    qint64 now = clock.elapsed();
+    if (now > lastCheck && size >= lastSize) {
+        double current = (size - lastSize) * 1000.0 / (now - lastCheck);
+        rate = rate == 0.0 ? current : 0.7 * rate + 0.3 * current;
+    }
+    lastSize = size;
+    lastCheck = now;
+
+    //level only escalates within one file, it is reset by start()
+    Level newLevel = this->get_level();
+    if (newLevel > level) {
+        level = newLevel;
+        emit level_changed(level);
+    }
+    emit updated();
+}
+
+DiskMonitor::Level DiskMonitor::get_level() const {
+    if (freeBytes < 0)
+        return Normal;
+    if (freeBytes < thresholds.minimumFreeBytes)
+        return Fallback;
+    qint64 left = this->seconds_left();
+    if (left < 0)
+        return Normal;
+    if (left < thresholds.fallbackSeconds)
+        return Fallback;
+    if (left < thresholds.lowerBitrateSeconds)
+        return LowerBitrate;
+    if (left < thresholds.warnSeconds)
+        return Warning;
+    return Normal;
+}
+
+const int DiskMonitor::INTERVAL = 1000;
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+#include <QStorageInfo>
+#include <QElapsedTimer>
+
+class DiskMonitor : public QObject {
+    Q_OBJECT
+public:
+    enum Level {
+        Normal,
+        Warning,        //time to full below warnSeconds
+        LowerBitrate,   //time to full below lowerBitrateSeconds
+        Fallback        //time to full below fallbackSeconds or free space below minimum
+    };
+
+    struct Thresholds {
+        int warnSeconds;
+        int lowerBitrateSeconds;
+        int fallbackSeconds;
+        qint64 minimumFreeBytes;
+    };
+
+    DiskMonitor(QObject *parent = nullptr);
+    ~DiskMonitor();
+
+    void set_thresholds(const Thresholds &thresholds);
+    const Thresholds &get_thresholds() const;
+
+    void start(const QString &filePath);
+    void stop();
+    bool has_space(const QString &directory) const;
+
+    double bytes_per_second() const;
+    qint64 free_bytes() const;
+    qint64 seconds_left() const;
+signals:
+    void level_changed(DiskMonitor::Level level);
+    void updated();
+private slots:
+    void check();
+private:
+    Level get_level() const;
+
+    QTimer *timer;
+    QElapsedTimer clock;
+    QStorageInfo storage;
+    QString filePath;
+    Thresholds thresholds;
+    Level level;
+    qint64 lastSize;
+    qint64 lastCheck;
+    qint64 freeBytes;
+    double rate;
+
+    static const int INTERVAL;
+};
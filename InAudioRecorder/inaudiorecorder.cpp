@@ -9,7 +9,18 @@ InAudioRecorder::InAudioRecorder(QWidget *parent)
     , statusLabel(new QLabel("Status: OK"))
     , recordProgressLabel(new QLabel("Record: none  "))
     , dialog(nullptr)
-    , moveFileData{ false, QString(), QString(), 0, -1 } {
+    , diskMonitor(new DiskMonitor(this))
+    , diskLabel(new QLabel("Disk: none  "))
+    , fallbackDirectory()
+    , rotation(DiskMonitor::Normal)
+    , archive()
+    , syncRecorder(new SyncRecorder(diskMonitor, this))
+    , syncDialog(nullptr)
+    , remoteCommand(false)
+    , lastNotice()
+    , moveFileData{ false, QString(), QString(), 0, -1 }
+    , markers{ -1, -1 }
+    , pendingEdit{ QUrl(), QString(), 0, -1 } {
 
     this->setupUi(this);
 
@@ -22,6 +33,8 @@ InAudioRecorder::InAudioRecorder(QWidget *parent)
     infoStatusBar->addWidget(statusLabel, 5);
     recordProgressLabel->setAlignment(Qt::AlignRight);
     infoStatusBar->addPermanentWidget(recordProgressLabel, 2);
+    diskLabel->setAlignment(Qt::AlignRight);
+    infoStatusBar->addPermanentWidget(diskLabel, 3);
 
     if (!probe->setSource(recorder))
         QMessageBox::critical(this, "Recorder error", "Could not enable audio probe. Unable to track record progress.");
@@ -31,6 +44,7 @@ InAudioRecorder::InAudioRecorder(QWidget *parent)
 
     this->set_icons();
     this->fill_labels();
+    this->load_disk_settings();
     this->connect_signals();
 
     qualityButton->click();
@@ -38,6 +52,47 @@ InAudioRecorder::InAudioRecorder(QWidget *parent)
     saveButton->setEnabled(false);
 }
 
+QJsonObject InAudioRecorder::handle_command(const QJsonObject &request) {
+    QString command = request.value("command").toString();
+    QMediaRecorder::State state = recorder->state();
+
+    if (command == "record") {
+        if (state == QMediaRecorder::PausedState)
+            this->recorder_pause();
+        else if (state == QMediaRecorder::StoppedState && recordButton->isEnabled()) {
+            remoteCommand = true;
+            QString error = this->start_record();
+            remoteCommand = false;
+            if (!error.isEmpty())
+                return ControlServer::error_reply(error);
+        } else
+            return ControlServer::error_reply("Already recording");
+    } else if (command == "stop") {
+        if (state == QMediaRecorder::StoppedState)
+            return ControlServer::error_reply("Not recording");
+        this->recorder_record();
+    } else if (command == "pause") {
+        if (state != QMediaRecorder::RecordingState)
+            return ControlServer::error_reply("Not recording");
+        this->recorder_pause();
+    } else if (command == "set-settings") {
+        if (state != QMediaRecorder::StoppedState)
+            return ControlServer::error_reply("Settings can not be changed while recording");
+        QString error = this->apply_remote_settings(request.value("settings").toObject());
+        if (!error.isEmpty())
+            return ControlServer::error_reply(error);
+    } else if (command != "status")
+        return ControlServer::error_reply("Unknown command: " + command);
+
+    QJsonObject reply = this->get_status();
+    reply.insert("ok", true);
+    return reply;
+}
+
+QString InAudioRecorder::records_path() {
+    return RECORDS.absolutePath();
+}
+
 
 
 
@@ -50,21 +105,20 @@ InAudioRecorder::InAudioRecorder(QWidget *parent)
 
 void InAudioRecorder::codec_index_changed(int index) {
     QAudioEncoderSettings settings = recorder->audioSettings();
-    settings.setCodec(audioCodec->itemData(index).toString());
+    QList<int> sampleRates, supportedBitrates;
+    this->get_codec_options(audioCodec->itemData(index).toString(), sampleRates, supportedBitrates);
 
     int currentInfo;
 
     sampleRate->clear();
     currentInfo = settings.sampleRate();
     sampleRate->addItem("Auto", currentInfo);
-    QList<int> sampleRates = recorder->supportedAudioSampleRates(settings);
     for (auto &x : sampleRates)
         sampleRate->addItem(QString::number(x / 1000.0) + "kHz", x);
 
     bitrates->clear();
     currentInfo = settings.bitRate();
     bitrates->addItem("Auto", currentInfo);
-    QList<int> supportedBitrates = recorder->supportedAudioSampleRates(settings);
     for (auto &x : supportedBitrates)
         bitrates->addItem(QString::number(x / 1000.0) + "kbps", x);
 }
@@ -83,12 +137,13 @@ void InAudioRecorder::encoding_option(bool qualityOption) {
 
 void InAudioRecorder::recorder_record() {
     if (recorder->state() == QMediaRecorder::State::StoppedState) {
-        this->apply_settings();
-        this->set_status("Starting record", "red");
-        recordButton->setEnabled(false);
-        recorder->record();
-    } else
+        QString error = this->start_record();
+        if (!error.isEmpty())
+            QMessageBox::critical(this, "Recorder error", error);
+    } else {
+        rotation = DiskMonitor::Normal;
         recorder->stop();
+    }
 }
 
 void InAudioRecorder::recorder_pause() {
@@ -100,14 +155,23 @@ void InAudioRecorder::recorder_pause() {
 
 void InAudioRecorder::recorder_state_changed(QMediaRecorder::State state) {
     if (state == QMediaRecorder::StoppedState) {
+        diskMonitor->stop();
+        diskLabel->setText("Disk: none  ");
+        archive.close();
         moveFileData.time = 0;
         this->set_record_time(-1);
         recordButton->setText("Record");
         pauseRecordButton->setText("Pause");
         pauseRecordButton->setEnabled(false);
         if (recorder->error()) {
+            rotation = DiskMonitor::Normal;
             this->set_status("Recording failed", "red");
             this->reset_record();
+        } else if (rotation != DiskMonitor::Normal) {
+            this->set_status("Switching output file", "red");
+            recordButton->setEnabled(false);
+            if (recorder->status() == QMediaRecorder::LoadedStatus)
+                this->rotate_record();
         } else {
             this->set_status("Recording finished", "blue");
         }
@@ -121,6 +185,8 @@ void InAudioRecorder::recorder_status_changed(QMediaRecorder::Status status) {
     if (status == QMediaRecorder::RecordingStatus) { //might be asynchronous (state changed before status)
         if (dialog != nullptr)
             dialog->set_current(recorder->outputLocation().toLocalFile());
+        diskMonitor->start(recorder->outputLocation().toLocalFile());
+        this->open_archive();
         moveFileData.fileNameTime = this->get_file_name_by_time();
         this->set_status("Recording", "green");
         recordButton->setEnabled(true);
@@ -132,6 +198,8 @@ void InAudioRecorder::recorder_status_changed(QMediaRecorder::Status status) {
         saveButton->setEnabled(true);
         recordProgressLabel->setText("Record: none  ");
         this->set_to_play(recorder->outputLocation());
+    } else if (status == QMediaRecorder::LoadedStatus && rotation != DiskMonitor::Normal) { //previous file finalized
+        this->rotate_record();
     }
 }
 
@@ -141,7 +209,7 @@ void InAudioRecorder::recorder_status_changed(QMediaRecorder::Status status) {
 
 
 void InAudioRecorder::recorder_error(QMediaRecorder::Error) {
-    QMessageBox::critical(this, "Recording error", recorder->errorString());
+    this->show_notice("Recording error", recorder->errorString());
     this->set_status("Recording failed", "red");
     this->reset_record();
 }
@@ -158,24 +226,75 @@ void InAudioRecorder::player_error(QMediaPlayer::Error) {
 
 
 void InAudioRecorder::recorder_process_buffer(const QAudioBuffer & buffer) {
+    if (archive.is_open() && !archive.write(buffer)) {
+        archive.close();
+        this->set_status("Archive writing failed", "red");
+    }
     std::int64_t oldTime = moveFileData.time;
     moveFileData.time += buffer.duration();
     if (moveFileData.time / 1000000 != oldTime / 1000000 || !oldTime)
         this->set_record_time(moveFileData.time);
 }
 
+void InAudioRecorder::disk_level_changed(DiskMonitor::Level level) {
+    if (recorder->state() == QMediaRecorder::StoppedState || rotation != DiskMonitor::Normal)
+        return;
+
+    QString outputDirectory = QFileInfo(recorder->outputLocation().toLocalFile()).absolutePath();
+    if (level == DiskMonitor::Warning) {
+        this->set_status(
+            "Low disk space, " + this->get_time_from_seconds(static_cast<int>(diskMonitor->seconds_left())) + " left",
+            "red"
+        );
+    } else if (level == DiskMonitor::LowerBitrate) {
+        QAudioEncoderSettings settings = recorder->audioSettings();
+        if (!this->get_lower_settings(settings)) { //already at the floor, new file would not help
+            this->set_status(
+                "Low disk space, " + this->get_time_from_seconds(static_cast<int>(diskMonitor->seconds_left())) + " left",
+                "red"
+            );
+            return;
+        }
+        this->set_status("Low disk space, lowering bitrate", "red");
+        rotation = DiskMonitor::LowerBitrate;
+        recorder->stop();
+    } else if (level == DiskMonitor::Fallback) {
+        if (fallbackDirectory.isEmpty() || QDir(fallbackDirectory).absolutePath() == outputDirectory) {
+            recorder->stop();
+            this->show_notice("Recorder error", "Disk is almost full, recording stopped.");
+        } else {
+            this->set_status("Low disk space, switching to fallback directory", "red");
+            rotation = DiskMonitor::Fallback;
+            recorder->stop();
+        }
+    }
+}
+
+void InAudioRecorder::disk_updated() {
+    diskLabel->setText(
+        "Disk: " + this->get_size_string(static_cast<double>(diskMonitor->free_bytes())) + " free, " +
+        this->get_size_string(diskMonitor->bytes_per_second()) + "/s  "
+    );
+}
+
 
 
 
 
 void InAudioRecorder::player_media_status_changed(QMediaPlayer::MediaStatus mediaStatus) {
-    if (mediaStatus == QMediaPlayer::LoadedMedia) {
+    if (mediaStatus == QMediaPlayer::NoMedia && !pendingEdit.path.isEmpty()) { //player released edited file
+        this->edit_record();
+    } else if (mediaStatus == QMediaPlayer::LoadedMedia) {
         audioPlayButton->setEnabled(true);
         audioPauseButton->setEnabled(true);
         audioStopButton->setEnabled(true);
         audioMuteButton->setEnabled(true);
         playProgress->setEnabled(true);
         soundSlider->setEnabled(true);
+        markInButton->setEnabled(true);
+        markOutButton->setEnabled(true);
+        splitButton->setEnabled(true);
+        this->update_markers();
 
         if (moveFileData.fixedPosition >= 0) {
             player->setPosition(moveFileData.fixedPosition);
@@ -231,6 +350,63 @@ void InAudioRecorder::player_progress_changed(int value) {
     player->setPosition(100ll * value);
 }
 
+void InAudioRecorder::player_mark_in() {
+    markers.in = player->position();
+    if (markers.out >= 0 && markers.out <= markers.in)
+        markers.out = -1;
+    this->update_markers();
+}
+
+void InAudioRecorder::player_mark_out() {
+    markers.out = player->position();
+    if (markers.in >= markers.out)
+        markers.in = -1;
+    this->update_markers();
+}
+
+void InAudioRecorder::player_trim() {
+    pendingEdit.path = player->currentMedia().canonicalUrl();
+    pendingEdit.secondPath.clear();
+    pendingEdit.from = std::max<std::int64_t>(markers.in, 0);
+    pendingEdit.to = markers.out;
+    this->release_for_edit();
+}
+
+void InAudioRecorder::player_split() {
+    pendingEdit.path = player->currentMedia().canonicalUrl();
+    pendingEdit.secondPath = InAudioRecorder::get_split_path(pendingEdit.path.toLocalFile());
+    pendingEdit.from = player->position();
+    pendingEdit.to = -1;
+    this->release_for_edit();
+}
+
+void InAudioRecorder::release_for_edit() {
+    //record is replaced by edited copy, backend closes it asynchronously, edit runs once player reports NoMedia
+    trimButton->setEnabled(false);
+    splitButton->setEnabled(false);
+    this->set_status("Waiting for player to release the record", "blue");
+    player->setMedia(QMediaContent());
+    if (player->mediaStatus() == QMediaPlayer::NoMedia && !pendingEdit.path.isEmpty())
+        this->edit_record();
+}
+
+void InAudioRecorder::edit_record() {
+    QUrl path = pendingEdit.path;
+    pendingEdit.path.clear();
+
+    RecordEditor editor(path.toLocalFile());
+    bool split = !pendingEdit.secondPath.isEmpty();
+    bool edited = split ? editor.split(pendingEdit.from, pendingEdit.secondPath) : editor.trim(pendingEdit.from, pendingEdit.to);
+    this->set_to_play(path);
+    if (!edited) {
+        this->set_status(split ? "Split error" : "Trim error", "red");
+        QMessageBox::critical(this, split ? "Split error" : "Trim error", editor.error_string());
+    } else if (split)
+        this->set_status("Record split, second part in " + QFileInfo(pendingEdit.secondPath).fileName(), "blue");
+    else
+        this->set_status("Record trimmed", "blue");
+}
+
 
 
 
@@ -274,6 +450,17 @@ void InAudioRecorder::options() {
     dialog->activateWindow();
 }
 
+void InAudioRecorder::sync_record() {
+    if (syncDialog == nullptr) {
+        syncDialog = new SyncRecordDialog(this, syncRecorder, RECORDS.absolutePath());
+        syncDialog->setAttribute(Qt::WA_DeleteOnClose, true);
+        QObject::connect(syncDialog, &QObject::destroyed, this, [&] {syncDialog = nullptr;});
+        syncDialog->show();
+    }
+    syncDialog->raise();
+    syncDialog->activateWindow();
+}
+
 
 
 
@@ -340,14 +527,213 @@ QString InAudioRecorder::get_file_name_by_time() const {
 
 
 
+QString InAudioRecorder::get_size_string(double bytes) const {
+    static const char *const UNITS[] = { "B", "kB", "MB", "GB", "TB" };
+    int unit = 0;
+    while (bytes >= 1024.0 && unit < 4) {
+        bytes /= 1024.0;
+        ++unit;
+    }
+    return QString::number(bytes, 'f', unit == 0 ? 0 : 1) + UNITS[unit];
+}
+
+QString InAudioRecorder::get_split_path(const QString &path) {
+    QFileInfo info(path);
+    if (info.fileName().startsWith("record_")) //second part of own record is next record, name_2 would break numbering
+        return InAudioRecorder::get_next_record_path(info.absoluteDir(), info.suffix());
+    QString splitPath;
+    int part = 2;
+    do {
+        splitPath = info.absoluteDir().filePath(info.completeBaseName() + "_" + QString::number(part++) + "." + info.suffix());
+    } while (QFileInfo::exists(splitPath));
+    return splitPath;
+}
+
+
+
+
+
+
+
 unsigned InAudioRecorder::get_idx_of_file(const QString & fileName) {
-    const int START_POS = 9;
+    const int START_POS = 7;    //length of "record_"
     int pastEndPos = fileName.indexOf('.', START_POS);
-    if (pastEndPos != -1)
-        return fileName.mid(START_POS, pastEndPos - START_POS).toInt();
-    return fileName.mid(START_POS).toInt();
+    bool ok = false;
+    unsigned index = fileName.mid(START_POS, pastEndPos != -1 ? pastEndPos - START_POS : -1).toUInt(&ok);
+    return ok ? index : 0;      //0 is never used by records
 }
 
+QString InAudioRecorder::get_next_record_path(const QDir &directory, const QString &suffix) {
+    QStringList list = directory.entryList(QDir::Files, QDir::Name);
+    auto newEnd = std::remove_if(list.begin(), list.end(), [](auto&& path) {
+        return !path.startsWith("record_");
+    });
+
+    std::vector<unsigned> indices;
+    indices.reserve(list.size());
+    std::transform(
+        list.begin(), newEnd,
+        std::back_inserter(indices),
+        &InAudioRecorder::get_idx_of_file
+    );
+    //names like record_00001_2 or foreign files do not take part in numbering
+    indices.erase(std::remove(indices.begin(), indices.end(), 0u), indices.end());
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+    unsigned nextNum = 0;
+    if (indices.empty() || indices.front() != 1)
+        nextNum = 1;
+    else {
+        for (std::size_t i = 1; i < indices.size(); ++i)
+            if (indices[i] - indices[i - 1] >= 2) {
+                nextNum = indices[i - 1] + 1;
+                break;
+            }
+        if (nextNum == 0)
+            nextNum = indices.back() + 1;
+    }
+
+    QString nextPath = QString("record_%1").arg(nextNum, 5, 10, QChar('0'));
+    if (!suffix.isEmpty())
+        nextPath += "." + suffix;
+    return directory.absoluteFilePath(nextPath);
+}
+
+
+
+
+
+QJsonObject InAudioRecorder::get_status() const {
+    static const char *const STATES[] = { "stopped", "recording", "paused" };
+
+    QJsonObject settings{
+        { "input", input->currentData().toString() },
+        { "codec", audioCodec->currentData().toString() },
+        { "container", container->currentData(Qt::UserRole + 1).toString() },
+        { "sampleRate", sampleRate->currentData().toInt() },
+        { "channels", channels->currentData().toInt() },
+        { "bitrate", bitrates->currentData().toInt() },
+        { "quality", quality->value() },
+        { "encodingMode", qualityButton->isChecked() ? "quality" : "bitrate" }
+    };
+    QJsonObject disk{
+        { "freeBytes", diskMonitor->free_bytes() },
+        { "bytesPerSecond", diskMonitor->bytes_per_second() },
+        { "secondsLeft", diskMonitor->seconds_left() }
+    };
+    BufferPool::Statistics pool = BufferPool::instance().get_statistics();
+    QJsonObject bufferPool{
+        { "blocks", pool.blocks },
+        { "inUse", pool.inUse },
+        { "segments", pool.segments },
+        { "acquires", pool.acquires }
+    };
+    return QJsonObject{
+        { "state", STATES[recorder->state()] },
+        { "file", recorder->state() == QMediaRecorder::StoppedState ? QString() : recorder->outputLocation().toLocalFile() },
+        { "durationMs", static_cast<qint64>(moveFileData.time / 1000) },
+        { "notice", lastNotice },
+        { "settings", settings },
+        { "disk", disk },
+        { "bufferPool", bufferPool },
+        { "sync", syncRecorder->is_running() ? QJsonValue(syncRecorder->get_statistics_json()) : QJsonValue() }
+    };
+}
+
+QJsonObject InAudioRecorder::get_archive_metadata() const {
+    QAudioEncoderSettings settings = recorder->audioSettings();
+    return QJsonObject{
+        { "device", recorder->audioInput() },
+        { "deviceDescription", recorder->audioInputDescription(recorder->audioInput()) },
+        { "record", recorder->outputLocation().fileName() },
+        { "codec", settings.codec() },
+        { "container", recorder->containerFormat() },
+        { "sampleRate", settings.sampleRate() },
+        { "channels", settings.channelCount() },
+        { "bitrate", settings.bitRate() },
+        { "quality", static_cast<int>(settings.quality()) },
+        { "encodingMode", settings.encodingMode() == QMultimedia::ConstantQualityEncoding ? "quality" : "bitrate" }
+    };
+}
+
+QString InAudioRecorder::apply_remote_settings(const QJsonObject &settings) {
+    //every key is validated before anything is applied, failed request leaves settings untouched
+    auto find = [&settings](QComboBox *box, const QString &key, int role = Qt::UserRole) {
+        if (!settings.contains(key))
+            return box->currentIndex();
+        QJsonValue value = settings.value(key);
+        return box->findData(value.isDouble() ? QVariant(value.toInt()) : QVariant(value.toString()), role);
+    };
+
+    int codecIndex = find(audioCodec, "codec");
+    if (codecIndex == -1)
+        return "Unsupported codec";
+    int inputIndex = find(input, "input");
+    if (inputIndex == -1)
+        return "Unknown input";
+    int containerIndex = find(container, "container", Qt::UserRole + 1);
+    if (containerIndex == -1)
+        containerIndex = find(container, "container");
+    if (containerIndex == -1)
+        return "Unsupported container";
+    int channelIndex = find(channels, "channels");
+    if (channelIndex == -1)
+        return "Unsupported channel count";
+
+    //new codec refills sample rates and bitrates, they are looked up in lists it will get, Auto comes first
+    const bool refill = codecIndex != audioCodec->currentIndex();
+    QList<int> sampleRates, supportedBitrates;
+    if (refill)
+        this->get_codec_options(audioCodec->itemData(codecIndex).toString(), sampleRates, supportedBitrates);
+    QAudioEncoderSettings current = recorder->audioSettings();
+    auto find_number = [&settings, &find, refill](QComboBox *box, const QList<int> &values, int autoValue, const QString &key) {
+        if (!refill)
+            return find(box, key);
+        if (!settings.contains(key))
+            return 0;
+        QJsonValue value = settings.value(key);
+        if (!value.isDouble())
+            return -1;
+        if (value.toInt() == autoValue)
+            return 0;
+        int index = values.indexOf(value.toInt());
+        return index == -1 ? -1 : index + 1;
+    };
+    int rateIndex = find_number(sampleRate, sampleRates, current.sampleRate(), "sampleRate");
+    if (rateIndex == -1)
+        return "Unsupported sample rate";
+    int bitrateIndex = find_number(bitrates, supportedBitrates, current.bitRate(), "bitrate");
+    if (bitrateIndex == -1)
+        return "Unsupported bitrate";
+    QString mode = settings.value("encodingMode").toString();
+    if (settings.contains("encodingMode") && mode != "quality" && mode != "bitrate")
+        return "Unknown encoding mode";
+
+    audioCodec->setCurrentIndex(codecIndex);
+    input->setCurrentIndex(inputIndex);
+    container->setCurrentIndex(containerIndex);
+    channels->setCurrentIndex(channelIndex);
+    sampleRate->setCurrentIndex(rateIndex);
+    bitrates->setCurrentIndex(bitrateIndex);
+    if (settings.contains("quality"))
+        quality->setValue(settings.value("quality").toInt());
+    if (mode == "quality")
+        qualityButton->setChecked(true);
+    else if (mode == "bitrate")
+        bitrateButton->setChecked(true);
+    return QString();
+}
+
+void InAudioRecorder::get_codec_options(const QString &codec, QList<int> &sampleRates, QList<int> &supportedBitrates) const {
+    QAudioEncoderSettings settings = recorder->audioSettings();
+    settings.setCodec(codec);
+    sampleRates = recorder->supportedAudioSampleRates(settings);
+    supportedBitrates = recorder->supportedAudioSampleRates(settings);
+}
+
+
+
 
 
 
@@ -358,6 +744,7 @@ void InAudioRecorder::set_icons() {
     audioStopButton->setIcon(this->style()->standardIcon(QStyle::SP_MediaStop));
     audioMuteButton->setIcon(this->style()->standardIcon(QStyle::SP_MediaVolume));
     optionsButton->setIcon(this->style()->standardIcon(QStyle::SP_MessageBoxInformation));
+    syncButton->setIcon(this->style()->standardIcon(QStyle::SP_BrowserReload));
 }
 
 void InAudioRecorder::fill_labels() {
@@ -417,51 +804,17 @@ void InAudioRecorder::fill_labels() {
 
 
 
-inline void InAudioRecorder::set_output_location(const QString &suffix) {
-    if (!RECORDS.exists() && !RECORDS.mkpath(".")) {
-        QMessageBox::information(this, "Recorder error", "Could not create directory for output files.");
-        return;
-    }
-    QString nextPath;
-
-    QStringList list = RECORDS.entryList(QDir::Files, QDir::Name);
-    auto newEnd = std::remove_if(list.begin(), list.end(), [](auto&& path) {
-        return !path.startsWith("record_");
-    });
-
-    std::vector<unsigned> indices;
-    indices.reserve(list.size());
-    std::transform(
-        list.begin(), newEnd,
-        std::back_inserter(indices),
-        &InAudioRecorder::get_idx_of_file
-    );
-
-    int nextNum = 0;
-    if (indices.empty() || indices.front() != 1)
-        nextNum = 1;
-    else {
-        for (std::size_t i = 1; i < indices.size(); ++i)
-            if (indices[i] - indices[i - 1] >= 2) {
-                nextNum = indices[i - 1] + 1;
-                break;
-            }
-        if (nextNum == 0)
-            nextNum = indices.back() + 1;
-    }
-
-    nextPath = QString("record_%1").arg(nextNum, 5, 10, QChar('0'));
-    if (!suffix.isEmpty())
-        nextPath += "." + suffix;
-
-    nextPath = RECORDS.absoluteFilePath(nextPath);
+inline QString InAudioRecorder::set_output_location(const QDir &directory, const QString &suffix) {
+    if (!directory.exists() && !directory.mkpath("."))
+        return "Could not create directory for output files.";
+    QString nextPath = InAudioRecorder::get_next_record_path(directory, suffix);
 
     if (!recorder->setOutputLocation(QUrl::fromLocalFile(nextPath)))
-        QMessageBox::information(this, "Recorder error", "C ould not set path for output files.");
-
+        return "Could not set path for output files.";
+    return QString();
 }
 
-void InAudioRecorder::apply_settings() {
+QString InAudioRecorder::apply_settings() {
     QAudioEncoderSettings settings = recorder->audioSettings();
 
     settings.setCodec(audioCodec->currentData().toString());
@@ -476,8 +829,105 @@ void InAudioRecorder::apply_settings() {
     recorder->setAudioSettings(settings);
     recorder->setAudioInput(input->currentData().toString());
     recorder->setContainerFormat(container->currentData().toString());
-    this->set_output_location(container->currentData(Qt::UserRole + 1).toString());
+    return this->set_output_location(RECORDS, container->currentData(Qt::UserRole + 1).toString());
+}
+
+QString InAudioRecorder::start_record() {
+    //no message boxes here, used also by control server
+    lastNotice.clear();
+    if (!diskMonitor->has_space(RECORDS.exists() ? RECORDS.absolutePath() : QDir::currentPath()))
+        return "Not enough free disk space to start recording.";
+    QString error = this->apply_settings();
+    if (!error.isEmpty()) {
+        this->set_status("Recording not started", "red");
+        return error;
+    }
+
+    this->set_status("Starting record", "red");
+    recordButton->setEnabled(false);
+    recorder->record();
+    if (recorder->state() == QMediaRecorder::StoppedState) { //refused synchronously
+        this->set_status("Recording not started", "red");
+        this->reset_record();
+        return recorder->errorString().isEmpty() ? "Recording could not be started." : recorder->errorString();
+    }
+    return QString();
+}
+
+void InAudioRecorder::load_disk_settings() {
+    QSettings settings(SETTINGS_FILE, QSettings::IniFormat);
+    DiskMonitor::Thresholds thresholds = diskMonitor->get_thresholds();
+
+    settings.beginGroup("DiskGuard");
+    thresholds.warnSeconds = settings.value("warnSeconds", thresholds.warnSeconds).toInt();
+    thresholds.lowerBitrateSeconds = settings.value("lowerBitrateSeconds", thresholds.lowerBitrateSeconds).toInt();
+    thresholds.fallbackSeconds = settings.value("fallbackSeconds", thresholds.fallbackSeconds).toInt();
+    thresholds.minimumFreeBytes = settings.value("minimumFreeMB", thresholds.minimumFreeBytes >> 20).toLongLong() << 20;
+    fallbackDirectory = settings.value("fallbackDirectory", fallbackDirectory).toString();
+
+    //write back so that all keys are visible in the file
+    settings.setValue("warnSeconds", thresholds.warnSeconds);
+    settings.setValue("lowerBitrateSeconds", thresholds.lowerBitrateSeconds);
+    settings.setValue("fallbackSeconds", thresholds.fallbackSeconds);
+    settings.setValue("minimumFreeMB", thresholds.minimumFreeBytes >> 20);
+    settings.setValue("fallbackDirectory", fallbackDirectory);
+    settings.endGroup();
+
+    diskMonitor->set_thresholds(thresholds);
+}
+
+void InAudioRecorder::open_archive() {
+    archive.close();
+    if (!archiveCheckBox->isChecked())
+        return;
+    QFileInfo record(recorder->outputLocation().toLocalFile());
+    QString path = record.absoluteDir().absoluteFilePath(record.completeBaseName() + ".iar");
+    if (!archive.open(path, this->get_archive_metadata(), QDateTime::currentMSecsSinceEpoch()))
+        this->set_status("Could not create archive", "red");
+}
 
+bool InAudioRecorder::get_lower_settings(QAudioEncoderSettings &settings) const {
+    if (settings.codec().contains("pcm")) { //bitrate of pcm is controlled only by sample rate
+        int rate = settings.sampleRate() > 0 ? settings.sampleRate() : 44100;
+        if (rate <= MIN_SAMPLE_RATE)
+            return false;
+        settings.setSampleRate(std::max(rate / 2, MIN_SAMPLE_RATE));
+    } else {
+        int bitRate = settings.bitRate();
+        if (bitRate > 0 && bitRate <= MIN_BIT_RATE)
+            return false;
+        settings.setEncodingMode(QMultimedia::ConstantBitRateEncoding);
+        settings.setBitRate(bitRate > 0 ? std::max(bitRate / 2, MIN_BIT_RATE) : 64000);
+    }
+    return true;
+}
+
+void InAudioRecorder::rotate_record() {
+    QFileInfo previous(recorder->outputLocation().toLocalFile());
+    QDir directory = previous.absoluteDir();
+
+    if (rotation == DiskMonitor::LowerBitrate) {
+        QAudioEncoderSettings settings = recorder->audioSettings();
+        this->get_lower_settings(settings);
+        recorder->setAudioSettings(settings);
+    } else
+        directory = QDir(fallbackDirectory);
+    rotation = DiskMonitor::Normal;
+
+    if (!diskMonitor->has_space(directory.exists() ? directory.absolutePath() : QDir::currentPath())) {
+        this->set_status("Recording stopped", "red");
+        this->reset_record();
+        this->show_notice("Recorder error", "Not enough free disk space to continue recording.");
+        return;
+    }
+    QString error = this->set_output_location(directory, previous.suffix());
+    if (!error.isEmpty()) {
+        this->set_status("Recording stopped", "red");
+        this->reset_record();
+        this->show_notice("Recorder error", error);
+        return;
+    }
+    recorder->record();
 }
 
 
@@ -493,15 +943,25 @@ void InAudioRecorder::connect_signals() {
     QObject::connect(pauseRecordButton, &QPushButton::clicked, this, &InAudioRecorder::recorder_pause);
     QObject::connect(saveButton, &QPushButton::clicked, this, &InAudioRecorder::save_file);
     QObject::connect(optionsButton, &QPushButton::clicked, this, &InAudioRecorder::options);
+    QObject::connect(syncButton, &QToolButton::clicked, this, &InAudioRecorder::sync_record);
     QObject::connect(recorder, static_cast<void(QMediaRecorder::*)(QMediaRecorder::Error)>(&QAudioRecorder::error), this, static_cast<void(InAudioRecorder::*)(QMediaRecorder::Error)>(&InAudioRecorder::recorder_error));
     QObject::connect(recorder, &QAudioRecorder::stateChanged, this, &InAudioRecorder::recorder_state_changed);
     QObject::connect(recorder, &QAudioRecorder::statusChanged, this, &InAudioRecorder::recorder_status_changed);
     QObject::connect(probe, &QAudioProbe::audioBufferProbed, this, &InAudioRecorder::recorder_process_buffer);
+    QObject::connect(diskMonitor, &DiskMonitor::level_changed, this, &InAudioRecorder::disk_level_changed);
+    QObject::connect(diskMonitor, &DiskMonitor::updated, this, &InAudioRecorder::disk_updated);
+    QObject::connect(syncRecorder, &SyncRecorder::failed, this, [this](const QString &message) {
+        this->show_notice("Synchronized recording error", message);
+    });
     QObject::connect(player, static_cast<void(QMediaPlayer::*)(QMediaPlayer::Error)>(&QMediaPlayer::error), this, static_cast<void(InAudioRecorder::*)(QMediaPlayer::Error)>(&InAudioRecorder::player_error));
     QObject::connect(player, &QMediaPlayer::mediaStatusChanged, this, &InAudioRecorder::player_media_status_changed);
     QObject::connect(player, &QMediaPlayer::durationChanged, this, &InAudioRecorder::player_duration_changed);
     QObject::connect(player, &QMediaPlayer::positionChanged, this, &InAudioRecorder::player_position_changed);
     QObject::connect(playProgress, &QSlider::valueChanged, this, &InAudioRecorder::player_progress_changed);
+    QObject::connect(markInButton, &QPushButton::clicked, this, &InAudioRecorder::player_mark_in);
+    QObject::connect(markOutButton, &QPushButton::clicked, this, &InAudioRecorder::player_mark_out);
+    QObject::connect(trimButton, &QPushButton::clicked, this, &InAudioRecorder::player_trim);
+    QObject::connect(splitButton, &QPushButton::clicked, this, &InAudioRecorder::player_split);
     QObject::connect(audioPlayButton, &QToolButton::clicked, player, &QMediaPlayer::play);
     QObject::connect(audioPauseButton, &QToolButton::clicked, player, &QMediaPlayer::pause);
     QObject::connect(audioStopButton, &QToolButton::clicked, player, &QMediaPlayer::stop);
@@ -519,6 +979,17 @@ void InAudioRecorder::set_status(const QString & status, const QString & color)
     statusLabel->setText("Status: <font color=\"" + color + "\">" + status + "</font>");
 }
 
+void InAudioRecorder::show_notice(const QString &title, const QString &text) {
+    //not modal, GUI thread keeps serving control requests while notice is shown
+    lastNotice = text;
+    if (remoteCommand) //remote caller gets the error in reply
+        return;
+    QMessageBox *box = new QMessageBox(QMessageBox::Critical, title, text, QMessageBox::Ok, this);
+    box->setAttribute(Qt::WA_DeleteOnClose);
+    box->setModal(false);
+    box->show();
+}
+
 void InAudioRecorder::set_record_time(std::int64_t microseconds) {
     if (microseconds == -1)
         recordProgressLabel->setText("Record: None  ");
@@ -537,6 +1008,8 @@ void InAudioRecorder::set_record_time(std::int64_t microseconds) {
 
 void InAudioRecorder::set_to_play(const QUrl & path) {
     fileLabel->setText("File: " + path.fileName());
+    markers = { -1, -1 };
+    this->update_markers();
     player->setMedia(QMediaContent(path));
 }
 
@@ -578,6 +1051,22 @@ void InAudioRecorder::reset_player() {
     moveFileData.wasPlaying = false;
     moveFileData.time = 0;
     moveFileData.fixedPosition = -1;
+    markers = { -1, -1 };
+    markInButton->setEnabled(false);
+    markOutButton->setEnabled(false);
+    splitButton->setEnabled(false);
+    this->update_markers();
+}
+
+void InAudioRecorder::update_markers() {
+    auto text = [this](std::int64_t position) {
+        return position < 0 ? QString("--:--") : this->get_time_from_seconds(static_cast<int>(position / 1000));
+    };
+    markersLabel->setText(text(markers.in) + " - " + text(markers.out));
+    trimButton->setEnabled(markInButton->isEnabled() && (markers.in > 0 || markers.out >= 0));
 }
 
 const QDir InAudioRecorder::RECORDS(QStringLiteral("records"));
+const QString InAudioRecorder::SETTINGS_FILE(QStringLiteral("InAudioRecorder.ini"));
+const int InAudioRecorder::MIN_SAMPLE_RATE = 8000;
+const int InAudioRecorder::MIN_BIT_RATE = 32000;
@@ -10,6 +10,11 @@
 #include <chrono>
 #include <ctime>
 #include "optionsdialog.hpp"
+#include "diskmonitor.hpp"
+#include "controlserver.hpp"
+#include "archivewriter.hpp"
+#include "syncrecorddialog.hpp"
+#include "recordeditor.hpp"
 #include "ui_inaudiorecorder.h"
 namespace chrono = std::chrono;
 
@@ -18,6 +23,11 @@ class InAudioRecorder : public QMainWindow, private Ui::InAudioRecorderClass {
     Q_OBJECT
 public:
     InAudioRecorder(QWidget *parent = nullptr);
+
+    QJsonObject handle_command(const QJsonObject &request);
+
+    static QString records_path();
+    static QString get_split_path(const QString &path);
 private slots:
     void codec_index_changed(int index);
     void encoding_option(bool quality);
@@ -32,31 +42,52 @@ private slots:
 
     void recorder_process_buffer(const QAudioBuffer &buffer);
 
+    void disk_level_changed(DiskMonitor::Level level);
+    void disk_updated();
+
     void player_media_status_changed(QMediaPlayer::MediaStatus mediaStatus);
     void player_duration_changed(std::int64_t duration);
     void player_position_changed(std::int64_t position);
     void player_mute();
     void player_sound_changed(int value);
     void player_progress_changed(int value);
+    void player_mark_in();
+    void player_mark_out();
+    void player_trim();
+    void player_split();
 
     void save_file();
     void options();
+    void sync_record();
 private:
     QString get_suffix_by_mime(const QString &mimeType) const;
     QString get_time_from_seconds(int seconds) const;
     QString get_file_name_by_time() const;
+    QString get_size_string(double bytes) const;
 
     static unsigned get_idx_of_file(const QString &fileName);
+    static QString get_next_record_path(const QDir &directory, const QString &suffix);
 
     void set_icons();
     void fill_labels();
 
-    void set_output_location(const QString &suffix);
-    void apply_settings();
+    QJsonObject get_status() const;
+    QJsonObject get_archive_metadata() const;
+    void open_archive();
+    QString apply_remote_settings(const QJsonObject &settings);
+    void get_codec_options(const QString &codec, QList<int> &sampleRates, QList<int> &supportedBitrates) const;
+
+    QString set_output_location(const QDir &directory, const QString &suffix);
+    QString apply_settings();
+    QString start_record();
+    void load_disk_settings();
+    bool get_lower_settings(QAudioEncoderSettings &settings) const;
+    void rotate_record();
 
     void connect_signals();
 
     void set_status(const QString &status, const QString &color);
+    void show_notice(const QString &title, const QString &text);
     void set_record_time(std::int64_t microseconds);
 
     void set_to_play(const QUrl &path);
@@ -64,6 +95,9 @@ private:
 
     void reset_record();
     void reset_player();
+    void update_markers();
+    void release_for_edit();
+    void edit_record();
 
     QAudioRecorder *recorder;
     QAudioProbe *probe;
@@ -71,6 +105,15 @@ private:
     QLabel *statusLabel;
     QLabel *recordProgressLabel;
     OptionsDialog *dialog;
+    DiskMonitor *diskMonitor;
+    QLabel *diskLabel;
+    QString fallbackDirectory;
+    DiskMonitor::Level rotation;
+    ArchiveWriter archive;
+    SyncRecorder *syncRecorder;
+    SyncRecordDialog *syncDialog;
+    bool remoteCommand;     //no message boxes while control request is handled
+    QString lastNotice;     //last recording problem, also reported in status reply
     struct {
         bool wasPlaying;
         QString oldFilePath;
@@ -78,6 +121,19 @@ private:
         std::int64_t time;
         std::int64_t fixedPosition;
     } moveFileData;
+    struct {
+        std::int64_t in;    //player position in ms, -1 when not set
+        std::int64_t out;
+    } markers;
+    struct {
+        QUrl path;          //record waiting for player to release it, empty when none
+        QString secondPath; //split target, empty for trim
+        std::int64_t from;  //trim start or split position in ms
+        std::int64_t to;
+    } pendingEdit;
 
     static const QDir RECORDS;
+    static const QString SETTINGS_FILE;
+    static const int MIN_SAMPLE_RATE;
+    static const int MIN_BIT_RATE;
 };
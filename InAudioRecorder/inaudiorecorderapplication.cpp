@@ -3,7 +3,8 @@
 
 InAudioRecorderApplication::InAudioRecorderApplication(int & argc, char * argv[])
 	: QApplication(argc, argv)
-	, oneInstanceMemory("InAudioRecorder_OneInstanceMemory", this) {
+	, oneInstanceMemory("InAudioRecorder_OneInstanceMemory", this)
+	, controlServer(nullptr) {
 	oneInstanceMemory.create(1);
 }
 
@@ -22,3 +23,19 @@ void InAudioRecorderApplication::set_working_directory() const {
 	if (appPath != currentPath)
 		QDir::setCurrent(appPath);
 }
+
+bool InAudioRecorderApplication::start_control_server(const ControlServer::Handler &handler) {
+	if (controlServer == nullptr)
+		controlServer = new ControlServer(CONTROL_SERVER_NAME, handler, this);
+	if (!controlServer->listen()) {
+		std::cerr << "Control server error: " << controlServer->error_string().toStdString() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+QJsonObject InAudioRecorderApplication::send_command(const QJsonObject &request) const {
+	return ControlServer::send(CONTROL_SERVER_NAME, request);
+}
+
+const QString InAudioRecorderApplication::CONTROL_SERVER_NAME(QStringLiteral("InAudioRecorder_Control"));
@@ -1,11 +1,17 @@
 #pragma once
+#include "controlserver.hpp"
+
 class InAudioRecorderApplication : public QApplication {
 public:
 	InAudioRecorderApplication(int &argc, char *argv[]);
 	virtual ~InAudioRecorderApplication();
 	bool is_only_instance() const;
 	void set_working_directory() const;
+	bool start_control_server(const ControlServer::Handler &handler);
+	QJsonObject send_command(const QJsonObject &request) const;
 private:
 	mutable QSharedMemory oneInstanceMemory;
-};
+	ControlServer *controlServer;
 
+	static const QString CONTROL_SERVER_NAME;
+};
@@ -1,12 +1,206 @@
 #include "stdafx.h"
 #include "inaudiorecorderapplication.hpp"
 #include "inaudiorecorder.hpp"
+#include "recordsscanner.hpp"
+#include "archivereader.hpp"
+#include "wavformat.hpp"
+#include "recordeditor.hpp"
+#include <cstdio>
+#ifdef Q_OS_WIN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+
+static void attach_console() {
+#ifdef Q_OS_WIN
+    //release build is windows subsystem program, without redirection output goes to console of calling shell
+    if (GetFileType(GetStdHandle(STD_OUTPUT_HANDLE)) != FILE_TYPE_UNKNOWN || !AttachConsole(ATTACH_PARENT_PROCESS))
+        return;
+    std::freopen("CONOUT$", "w", stdout);
+    std::freopen("CONOUT$", "w", stderr);
+    std::cout.clear();
+    std::cerr.clear();
+#endif
+}
+
+static int scan_records(bool clean, bool onlyInstance) {
+    RecordsScanner scanner(InAudioRecorder::records_path());
+    RecordsScanner::Report report = scanner.scan();
+    std::cout << RecordsScanner::describe(report).toStdString();
+    if (!clean)
+        return EXIT_SUCCESS;
+    if (!onlyInstance) {
+        std::cerr << "Another instance of application is running, cleanup skipped." << std::endl;
+        return EXIT_FAILURE;
+    }
+    int removed = scanner.remove_redundant(report, RecordsScanner::Duplicates | RecordsScanner::Silent);
+    std::cout << "Removed " << removed << " records." << std::endl;
+    return EXIT_SUCCESS;
+}
+
+static int archive_info(const QString &path) {
+    ArchiveReader reader;
+    if (!reader.open(path)) {
+        std::cerr << "Could not open archive " << path.toStdString() << std::endl;
+        return EXIT_FAILURE;
+    }
+    const ArchiveHeader &header = reader.get_header();
+    QJsonObject info{
+        { "channels", header.channels },
+        { "sampleRate", static_cast<qint64>(header.sampleRate) },
+        { "bitsPerSample", header.bitsPerSample },
+        { "frames", static_cast<qint64>(header.totalFrames) },
+        { "blocks", static_cast<qint64>(reader.block_count()) },
+        { "recovered", reader.is_recovered() },
+        { "start", QDateTime::fromMSecsSinceEpoch(header.startTimestamp).toString(Qt::ISODate) },
+        { "loudness", header.loudness },
+        { "peak", header.peak },
+        { "metadata", reader.get_metadata() }
+    };
+    std::cout << QJsonDocument(info).toJson().toStdString();
+    return EXIT_SUCCESS;
+}
+
+static int unpack_archive(const QString &path) {
+    ArchiveReader reader;
+    if (!reader.open(path)) {
+        std::cerr << "Could not open archive " << path.toStdString() << std::endl;
+        return EXIT_FAILURE;
+    }
+    const ArchiveHeader &header = reader.get_header();
+    const int bytes = header.bitsPerSample / 8;
+    WavFormat format{
+        WavFormat::PCM, header.channels, header.sampleRate,
+        static_cast<quint16>(header.channels * bytes), header.bitsPerSample,
+        WavFormat::HEADER_SIZE, static_cast<qint64>(header.totalFrames) * header.channels * bytes
+    };
+    if (format.dataSize > WavFormat::MAX_DATA_SIZE) {
+        std::cerr << "Decoded audio is larger than 4 GiB and does not fit into a wav file, trim or split the archive first" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    QFileInfo info(path);
+    QSaveFile output(info.absoluteDir().absoluteFilePath(info.completeBaseName() + ".wav"));
+    if (!output.open(QIODevice::WriteOnly) || output.write(format.serialize()) != WavFormat::HEADER_SIZE) {
+        std::cerr << "Could not create " << output.fileName().toStdString() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const qint64 CHUNK_FRAMES = 65536;
+    std::vector<std::int32_t> samples(static_cast<std::size_t>(CHUNK_FRAMES * header.channels));
+    QByteArray pcm;
+    qint64 frames;
+    while ((frames = reader.read(samples.data(), CHUNK_FRAMES)) > 0) {
+        pcm.resize(static_cast<int>(frames * header.channels * bytes));
+        uchar *p = reinterpret_cast<uchar*>(pcm.data());
+        for (qint64 i = 0; i < frames * header.channels; ++i, p += bytes)
+            for (int b = 0; b < bytes; ++b)
+                p[b] = static_cast<uchar>(samples[i] >> (8 * b));
+        if (output.write(pcm) != pcm.size())
+            return EXIT_FAILURE;
+    }
+    if (frames < 0 || !output.commit()) {
+        std::cerr << "Archive is damaged" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << output.fileName().toStdString() << std::endl;
+    return EXIT_SUCCESS;
+}
+
+static int edit_record(const QString &path, qint64 startMs, qint64 endMs, qint64 splitMs) {
+    RecordEditor editor(path);
+    QString secondPath;
+    bool ok;
+    if (splitMs >= 0) {
+        secondPath = InAudioRecorder::get_split_path(path);
+        ok = editor.split(splitMs, secondPath);
+    } else
+        ok = editor.trim(startMs, endMs);
+    if (!ok) {
+        std::cerr << editor.error_string().toStdString() << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (!secondPath.isEmpty())
+        std::cout << secondPath.toStdString() << std::endl;
+    return EXIT_SUCCESS;
+}
+
+static QJsonObject make_request(const QStringList &arguments) {
+    QJsonObject request{ { "command", arguments.front() } };
+    if (arguments.front() == "set-settings") {
+        QJsonObject settings;
+        for (auto &argument : arguments.mid(1)) {
+            QString key = argument.section('=', 0, 0);
+            QString value = argument.section('=', 1);
+            bool isNumber;
+            int number = value.toInt(&isNumber);
+            settings.insert(key, isNumber ? QJsonValue(number) : QJsonValue(value));
+        }
+        request.insert("settings", settings);
+    }
+    return request;
+}
 
 
 int main(int argc, char *argv[]) {
+    attach_console();
     InAudioRecorderApplication application(argc, argv);
     InAudioRecorderApplication::setWindowIcon(QIcon(":/InAudioRecorder/programIcon.ico"));
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption scanOption("scan", "Report duplicate, similar and silent records.");
+    QCommandLineOption cleanOption("clean", "Remove duplicate and silent records.");
+    parser.addOption(scanOption);
+    parser.addOption(cleanOption);
+    QCommandLineOption infoOption("archive-info", "Print header and metadata of archive.", "file");
+    QCommandLineOption unpackOption("unpack", "Decode archive to wav file next to it.", "file");
+    parser.addOption(infoOption);
+    parser.addOption(unpackOption);
+    QCommandLineOption trimOption("trim", "Keep only part of wav, mp3 or archive file given by --from and --to.", "file");
+    QCommandLineOption splitOption("split", "Move part of wav, mp3 or archive file after --at to a new file.", "file");
+    QCommandLineOption fromOption("from", "Start of kept part in milliseconds.", "ms", "0");
+    QCommandLineOption toOption("to", "End of kept part in milliseconds, end of file when missing.", "ms", "-1");
+    QCommandLineOption atOption("at", "Split position in milliseconds.", "ms");
+    parser.addOption(trimOption);
+    parser.addOption(splitOption);
+    parser.addOption(fromOption);
+    parser.addOption(toOption);
+    parser.addOption(atOption);
+    parser.addPositionalArgument(
+        "command",
+        "Command for running instance: record, stop, pause, status or set-settings key=value...",
+        "[command [arguments...]]"
+    );
+    parser.process(application);
+    QStringList arguments = parser.positionalArguments();
+    if (parser.isSet(infoOption))
+        return archive_info(parser.value(infoOption));
+    if (parser.isSet(unpackOption))
+        return unpack_archive(parser.value(unpackOption));
+    if (parser.isSet(trimOption))
+        return edit_record(parser.value(trimOption), parser.value(fromOption).toLongLong(), parser.value(toOption).toLongLong(), -1);
+    if (parser.isSet(splitOption)) {
+        bool isNumber;
+        qint64 at = parser.value(atOption).toLongLong(&isNumber);
+        if (!isNumber || at < 0) {
+            std::cerr << "Split position --at is missing" << std::endl;
+            return EXIT_FAILURE;
+        }
+        return edit_record(parser.value(splitOption), 0, -1, at);
+    }
+    if (parser.isSet(scanOption) || parser.isSet(cleanOption)) {
+        application.set_working_directory();
+        return scan_records(parser.isSet(cleanOption), application.is_only_instance());
+    }
+
     if (!application.is_only_instance()) {
+        if (!arguments.empty()) {
+            QJsonObject reply = application.send_command(make_request(arguments));
+            std::cout << QJsonDocument(reply).toJson(QJsonDocument::Compact).toStdString() << std::endl;
+            return reply.value("ok").toBool() ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
         QMessageBox::information(nullptr, "Start Error", "Another instance of application is already running. Exitting.");
         return EXIT_SUCCESS;
     }
@@ -21,5 +215,14 @@ int main(int argc, char *argv[]) {
         )
     );
     recorder.show();
+
+    application.start_control_server([&recorder](const QJsonObject &request) {
+        return recorder.handle_command(request);
+    });
+    if (!arguments.empty()) //first instance executes its own command after startup
+        QTimer::singleShot(0, &recorder, [&recorder, arguments] {
+            QJsonObject reply = recorder.handle_command(make_request(arguments));
+            std::cout << QJsonDocument(reply).toJson(QJsonDocument::Compact).toStdString() << std::endl;
+        });
     return application.exec();
 }
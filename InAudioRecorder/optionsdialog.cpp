@@ -5,16 +5,23 @@
 
 OptionsDialog::OptionsDialog(QWidget *parent, const QString &path, const QString &_current)
 	: QDialog(parent)
-	, current(_current) {
+	, current(_current)
+	, scanner(new RecordsScanner(path, this))
+	, scanWatcher(new QFutureWatcher<RecordsScanner::Report>(this)) {
 	this->setupUi(this);
 	this->setWindowFlags(this->windowFlags() & ~Qt::WindowContextHelpButtonHint);
 	this->setWindowTitle("Options");
 	recordsPath->setText(path);
-	directoryContains->setText(QString("%1 records").arg(QDir(path).count() - 2));
+	this->update_count();
 	QObject::connect(openDirectoryButton, &QPushButton::clicked, this, [&] {
 		QDesktopServices::openUrl(QUrl::fromLocalFile(recordsPath->text()));
 	});
 	QObject::connect(clearDirectoryButton, &QPushButton::clicked, this, &OptionsDialog::clear_directory);
+	QObject::connect(scanDirectoryButton, &QPushButton::clicked, this, &OptionsDialog::scan_directory);
+	QObject::connect(scanWatcher, &QFutureWatcher<RecordsScanner::Report>::finished, this, &OptionsDialog::scan_finished);
+	QObject::connect(scanner, &RecordsScanner::progress, this, [&](int done, int total) {
+		directoryContains->setText(QString("Scanning %1/%2").arg(done).arg(total));
+	});
 
 	recordsPath->adjustSize();
 	this->adjustSize();
@@ -24,7 +31,9 @@ OptionsDialog::OptionsDialog(QWidget *parent, const QString &path, const QString
 	this->setMinimumWidth(this->width());
 }
 
-OptionsDialog::~OptionsDialog() {}
+OptionsDialog::~OptionsDialog() {
+	scanWatcher->waitForFinished();
+}
 
 void OptionsDialog::set_current(const QString & _current) {
 	current = _current;
@@ -36,5 +45,51 @@ void OptionsDialog::clear_directory() {
 	for (auto &x : list)
 		if (x.absoluteFilePath() != current)
 			QFile(x.absoluteFilePath()).remove();	
-	directoryContains->setText(QString("%1 records").arg(QDir(path).count() - 2));
+	this->update_count();
+}
+
+void OptionsDialog::scan_directory() {
+	if (scanWatcher->isRunning())
+		return;
+	scanDirectoryButton->setEnabled(false);
+	clearDirectoryButton->setEnabled(false);
+	scanWatcher->setFuture(QtConcurrent::run([this] { return scanner->scan(); }));
+}
+
+void OptionsDialog::scan_finished() {
+	RecordsScanner::Report report = scanWatcher->result();
+	scanDirectoryButton->setEnabled(true);
+	clearDirectoryButton->setEnabled(true);
+	this->update_count();
+
+	if (report.duplicates.empty() && report.similar.empty() && report.silent.empty()) {
+		QMessageBox::information(this, "Scan finished", RecordsScanner::describe(report) + "No redundant records found.");
+		return;
+	}
+
+	QMessageBox box(QMessageBox::Question, "Scan finished",
+		QString("Found %1 duplicate groups, %2 similar groups and %3 silent records.")
+		.arg(report.duplicates.size())
+		.arg(report.similar.size())
+		.arg(report.silent.size()),
+		QMessageBox::NoButton, this);
+	box.setDetailedText(RecordsScanner::describe(report));
+	QPushButton *removeButton = box.addButton("Remove duplicates and silent", QMessageBox::DestructiveRole);
+	QPushButton *removeAllButton = box.addButton("Remove also similar", QMessageBox::DestructiveRole);
+	box.addButton(QMessageBox::Cancel);
+	box.exec();
+
+	int flags = RecordsScanner::Duplicates | RecordsScanner::Silent;
+	if (box.clickedButton() == removeAllButton)
+		flags |= RecordsScanner::Similar;
+	else if (box.clickedButton() != removeButton)
+		return;
+
+	int removed = scanner->remove_redundant(report, flags, current);
+	this->update_count();
+	QMessageBox::information(this, "Cleanup finished", QString("Removed %1 records.").arg(removed));
+}
+
+void OptionsDialog::update_count() {
+	directoryContains->setText(QString("%1 records").arg(QDir(recordsPath->text()).count() - 2));
 }
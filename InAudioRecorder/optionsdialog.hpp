@@ -1,6 +1,8 @@
 #pragma once
 
 #include <QDialog>
+#include <QFutureWatcher>
+#include "recordsscanner.hpp"
 #include "ui_optionsdialog.h"
 
 class OptionsDialog : public QDialog, public Ui::OptionsDialog {
@@ -11,6 +13,12 @@ public:
 	void set_current(const QString &current);
 private slots:
 	void clear_directory();
+	void scan_directory();
+	void scan_finished();
 private:
+	void update_count();
+
 	QString current;
+	RecordsScanner *scanner;
+	QFutureWatcher<RecordsScanner::Report> *scanWatcher;
 };
@@ -0,0 +1,552 @@
+#include "stdafx.h"
+#include "recordeditor.hpp"
+#include "archivereader.hpp"
+#include "bufferpool.hpp"
+#include <cstring>
+
+namespace {
+    quint32 read_synchsafe(const uchar *data) {
+        return (quint32(data[0] & 0x7F) << 21) | (quint32(data[1] & 0x7F) << 14) |
+               (quint32(data[2] & 0x7F) << 7) | quint32(data[3] & 0x7F);
+    }
+}
+
+RecordEditor::RecordEditor(const QString &_path)
+    : path(_path)
+    , errorString() {}
+
+bool RecordEditor::trim(qint64 startMs, qint64 endMs) {
+    errorString.clear();
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+        return this->fail("Could not open " + path);
+    startMs = std::max<qint64>(0, startMs);
+
+    switch (this->detect(file)) {
+    case Wav: {
+        WavFormat wav;
+        if (!WavFormat::read(file, wav))
+            return this->fail("Invalid wav file");
+        if (!wav.is_supported())
+            return this->fail("Only pcm and float wav files can be cut");
+        const qint64 frames = wav.frames();
+        const qint64 first = std::min(frames, startMs * wav.sampleRate / 1000);
+        const qint64 last = endMs < 0 ? frames : qBound(first, endMs * wav.sampleRate / 1000, frames);
+        return this->cut_wav(file, wav, first, last, path);
+    }
+    case Mpeg: {
+        MpegLayout layout;
+        if (!this->read_mpeg(file, layout))
+            return false;
+        //frame holding start is kept, as well as frame holding end
+        const qint64 unit = 1000ll * layout.samples;
+        const qint64 count = static_cast<qint64>(layout.count);
+        const qint64 first = std::min(count, startMs * layout.sampleRate / unit);
+        const qint64 last = endMs < 0 ? count : qBound(first, (endMs * layout.sampleRate + unit - 1) / unit, count);
+        return this->cut_mpeg(file, layout, static_cast<std::size_t>(first), static_cast<std::size_t>(last), path);
+    }
+    case Archive: {
+        ArchiveLayout layout;
+        if (!this->read_archive(layout))
+            return false;
+        const quint64 first = static_cast<quint64>(startMs) * layout.header.sampleRate / 1000;
+        const quint64 last = endMs < 0 ? layout.header.totalFrames : static_cast<quint64>(endMs) * layout.header.sampleRate / 1000;
+        //blocks overlapping [first, last) are kept
+        auto begin = layout.blocks.begin();
+        auto firstBlock = std::upper_bound(begin, layout.blocks.end(), first,
+            [](quint64 frame, const std::pair<quint64, quint64> &block) { return frame < block.first; }) - 1;
+        auto lastBlock = std::lower_bound(begin, layout.blocks.end(), last,
+            [](const std::pair<quint64, quint64> &block, quint64 frame) { return block.first < frame; });
+        return this->cut_archive(file, layout, static_cast<std::size_t>(firstBlock - begin), static_cast<std::size_t>(lastBlock - begin), path);
+    }
+    default:
+        return this->fail("Cutting " + QFileInfo(path).suffix() + " files without re-encoding is not supported");
+    }
+}
+
+bool RecordEditor::split(qint64 positionMs, const QString &secondPath) {
+    errorString.clear();
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+        return this->fail("Could not open " + path);
+
+    switch (this->detect(file)) {
+    case Wav:
+        return this->split_wav(file, positionMs, secondPath);
+    case Mpeg: {
+        MpegLayout layout;
+        return this->read_mpeg(file, layout) && this->split_mpeg(file, layout, positionMs, secondPath);
+    }
+    case Archive: {
+        ArchiveLayout layout;
+        return this->read_archive(layout) && this->split_archive(file, layout, positionMs, secondPath);
+    }
+    default:
+        return this->fail("Splitting " + QFileInfo(path).suffix() + " files without re-encoding is not supported");
+    }
+}
+
+QString RecordEditor::error_string() const {
+    return errorString;
+}
+
+
+
+
+
+RecordEditor::Format RecordEditor::detect(QFile &file) const {
+    QByteArray head = file.read(12);
+    file.seek(0);
+    if (head.size() == 12 && head.startsWith("RIFF") && head.mid(8, 4) == "WAVE")
+        return Wav;
+    if (head.size() >= 4 && std::memcmp(head.constData(), ArchiveHeader::MAGIC, sizeof(ArchiveHeader::MAGIC)) == 0)
+        return Archive;
+
+    //sync words are too weak to recognize mpeg audio by content alone
+    QString suffix = QFileInfo(path).suffix().toLower();
+    MpegFrame frame;
+    if ((suffix == "mp3" || suffix == "mp2" || suffix == "mpga") && head.size() >= 4 &&
+        (head.startsWith("ID3") || RecordEditor::parse_mpeg_frame(reinterpret_cast<const uchar*>(head.constData()), frame)))
+        return Mpeg;
+    return Unknown;
+}
+
+
+
+
+
+bool RecordEditor::cut_wav(QFile &file, const WavFormat &wav, qint64 first, qint64 last, const QString &target) {
+    const qint64 size = (last - first) * wav.blockAlign;
+    if (size <= 0)
+        return this->fail("Nothing would be left of the record");
+
+    //chunks in front of data are kept, chunks after data are dropped, odd data chunk is followed by pad byte
+    QByteArray header;
+    if (file.seek(0))
+        header = file.read(wav.dataOffset);
+    if (header.size() != wav.dataOffset)
+        return this->fail("Could not read " + path);
+    qToLittleEndian(static_cast<quint32>(wav.dataOffset - 8 + size + (size & 1)), reinterpret_cast<uchar*>(header.data() + 4));
+    qToLittleEndian(static_cast<quint32>(size), reinterpret_cast<uchar*>(header.data() + wav.dataOffset - 4));
+    const qint64 start = wav.dataOffset + first * wav.blockAlign;
+    return this->save(file, target, { { header, start, start + size }, { QByteArray(size & 1, '\0'), 0, 0 } });
+}
+
+bool RecordEditor::split_wav(QFile &file, qint64 positionMs, const QString &secondPath) {
+    WavFormat wav;
+    if (!WavFormat::read(file, wav))
+        return this->fail("Invalid wav file");
+    if (!wav.is_supported())    //compressed data can not be cut at arbitrary frame
+        return this->fail("Only pcm and float wav files can be split");
+    const qint64 frames = wav.frames();
+    const qint64 position = positionMs * wav.sampleRate / 1000;
+    if (position <= 0 || position >= frames)
+        return this->fail("Split position is outside of the record");
+    if (!this->cut_wav(file, wav, position, frames, secondPath))
+        return false;
+    if (this->cut_wav(file, wav, 0, position, path))
+        return true;
+    QFile::remove(secondPath);
+    return false;
+}
+
+
+
+
+
+bool RecordEditor::read_mpeg(QFile &file, MpegLayout &layout) {
+    const qint64 size = file.size();
+    const uchar *data = size > 0 ? file.map(0, size) : nullptr;
+    if (data == nullptr)
+        return this->fail("Could not read " + path);
+
+    layout.tagEnd = 0;
+    if (size >= ID3_HEADER_SIZE && std::memcmp(data, "ID3", 3) == 0) {
+        const bool footer = (data[5] & 0x10) != 0;
+        layout.tagEnd = std::min<qint64>(size, ID3_HEADER_SIZE + read_synchsafe(data + 6) + (footer ? ID3_HEADER_SIZE : 0));
+    }
+    layout.audioEnd = size - layout.tagEnd >= 128 && std::memcmp(data + size - 128, "TAG", 3) == 0 ? size - 128 : size;
+    layout.info.clear();
+    layout.infoOffset = -1;
+    layout.samples = 0;
+    layout.sampleRate = 0;
+    layout.count = 0;
+    layout.audioStart = layout.tagEnd;
+    layout.frameBytes = 0.0;
+    layout.pattern = 0;
+    layout.frames.clear();
+
+    //first frame is trusted when next one follows it, Xing frame marks variable bitrate
+    qint64 position = layout.tagEnd;
+    MpegFrame frame, next;
+    while (position + 4 <= layout.audioEnd) {
+        if (RecordEditor::parse_mpeg_frame(data + position, frame) && position + frame.size + 4 <= layout.audioEnd &&
+            RecordEditor::parse_mpeg_frame(data + position + frame.size, next))
+            break;
+        ++position;
+    }
+    if (position + 4 <= layout.audioEnd) {
+        const uchar *tag = data + position + 4 + frame.sideInfo;
+        const bool hasTag = frame.size >= 4 + frame.sideInfo + 8;
+        if (hasTag && std::memcmp(tag, "Info", 4) == 0) {
+            layout.info = QByteArray(reinterpret_cast<const char*>(data + position), frame.size);
+            layout.infoOffset = position;
+            position += frame.size;
+            frame = next;
+        }
+        if (!hasTag || std::memcmp(tag, "Xing", 4) != 0) {
+            layout.samples = frame.samples;
+            layout.sampleRate = frame.sampleRate;
+            layout.audioStart = position;
+            layout.frameBytes = frame.samples / 8.0 * frame.bitrate / frame.sampleRate;
+            layout.pattern = qFromBigEndian<quint32>(data + position) & CBR_HEADER_MASK;
+        }
+    }
+    file.unmap(const_cast<uchar*>(data));
+
+    //constant bitrate stream is located by arithmetic, frame count is right when last frame ends the audio,
+    //frame in the middle guards against variable bitrate stream without Xing frame
+    if (layout.frameBytes > 0.0) {
+        const std::size_t estimate = static_cast<std::size_t>((layout.audioEnd - layout.audioStart) / layout.frameBytes + 0.5);
+        for (std::size_t count = estimate; count > 0 && count + 1 >= estimate; --count) {
+            layout.count = count;
+            if (RecordEditor::find_cbr_frame(file, layout, count) == layout.audioEnd)
+                return RecordEditor::find_cbr_frame(file, layout, count / 2) >= 0 || this->scan_mpeg(file, layout);
+        }
+    }
+    return this->scan_mpeg(file, layout);
+}
+
+bool RecordEditor::scan_mpeg(QFile &file, MpegLayout &layout) {
+    const qint64 size = file.size();
+    const uchar *data = size > 0 ? file.map(0, size) : nullptr;
+    if (data == nullptr)
+        return this->fail("Could not read " + path);
+
+    layout.info.clear();
+    layout.infoOffset = -1;
+    layout.frameBytes = 0.0;
+    layout.frames.clear();
+
+    //only frame headers are read, after garbage a header is trusted when next one follows it
+    qint64 position = layout.tagEnd, end = position;
+    MpegFrame frame, next;
+    while (position + 4 <= layout.audioEnd) {
+        const bool trusted = position == end && (!layout.frames.empty() || !layout.info.isEmpty());
+        if (!RecordEditor::parse_mpeg_frame(data + position, frame) || position + frame.size > layout.audioEnd ||
+            (!trusted && position + frame.size + 4 <= layout.audioEnd && !RecordEditor::parse_mpeg_frame(data + position + frame.size, next))) {
+            ++position;
+            continue;
+        }
+        if (layout.frames.empty() && layout.info.isEmpty()) {
+            layout.samples = frame.samples;
+            layout.sampleRate = frame.sampleRate;
+            const uchar *tag = data + position + 4 + frame.sideInfo;
+            if (frame.size >= 4 + frame.sideInfo + 8 && (std::memcmp(tag, "Xing", 4) == 0 || std::memcmp(tag, "Info", 4) == 0)) {
+                layout.info = QByteArray(reinterpret_cast<const char*>(data + position), frame.size);
+                layout.infoOffset = position;
+                position = end = position + frame.size;
+                continue;
+            }
+        }
+        layout.frames.push_back(position);
+        position = end = position + frame.size;
+    }
+    layout.frames.push_back(end);
+    file.unmap(const_cast<uchar*>(data));
+
+    if (layout.frames.size() < 2)
+        return this->fail("No mpeg audio frames found in " + path);
+    layout.count = layout.frames.size() - 1;
+    layout.audioStart = layout.frames.front();
+    return true;
+}
+
+bool RecordEditor::mpeg_frame(QFile &file, MpegLayout &layout, std::size_t &index, qint64 &offset) {
+    if (layout.frameBytes > 0.0) {
+        offset = RecordEditor::find_cbr_frame(file, layout, index);
+        if (offset >= 0)
+            return true;
+        //stream is damaged somewhere before index, frames located so far are still valid
+        if (!this->scan_mpeg(file, layout))
+            return false;
+    }
+    index = std::min(index, layout.count);
+    offset = layout.frames[index];
+    return true;
+}
+
+bool RecordEditor::cut_mpeg(QFile &file, MpegLayout &layout, std::size_t first, std::size_t last, const QString &target) {
+    //earlier frames are located first, falling back to scan can only shift later ones
+    qint64 start, end;
+    if (!this->mpeg_frame(file, layout, first, start) || !this->mpeg_frame(file, layout, last, end))
+        return false;
+    if (first >= last)
+        return this->fail("Nothing would be left of the record");
+
+    //tags are kept, bytes between ID3v2 tag and first frame are dropped
+    QByteArray tag, info;
+    if (file.seek(0))
+        tag = file.read(layout.tagEnd);
+    if (tag.size() != layout.tagEnd)
+        return this->fail("Could not read " + path);
+    if (!layout.info.isEmpty())
+        info = RecordEditor::update_info_frame(layout.info, static_cast<quint32>(last - first),
+                                               static_cast<quint32>(layout.info.size() + end - start));
+    return this->save(file, target, { { tag + info, start, end }, { QByteArray(), layout.audioEnd, file.size() } });
+}
+
+bool RecordEditor::split_mpeg(QFile &file, MpegLayout &layout, qint64 positionMs, const QString &secondPath) {
+    //split at nearest frame boundary
+    const qint64 unit = 1000ll * layout.samples;
+    const std::size_t position = static_cast<std::size_t>(std::max<qint64>(0, (positionMs * layout.sampleRate + unit / 2) / unit));
+    if (position == 0 || position >= layout.count)
+        return this->fail("Split position is outside of the record");
+    if (!this->cut_mpeg(file, layout, position, layout.count, secondPath))
+        return false;
+    if (this->cut_mpeg(file, layout, 0, position, path))
+        return true;
+    QFile::remove(secondPath);
+    return false;
+}
+
+
+
+
+
+bool RecordEditor::read_archive(ArchiveLayout &layout) {
+    ArchiveReader reader;
+    if (!reader.open(path))
+        return this->fail("Invalid or unfinished archive " + path);
+    layout.header = reader.get_header();
+    layout.blocks.clear();
+    for (quint64 i = 0; i < reader.block_count(); ++i)
+        layout.blocks.emplace_back(reader.block_frame(i), reader.block_offset(i));
+    if (layout.blocks.empty())
+        return this->fail("Archive is empty");
+    return true;
+}
+
+bool RecordEditor::cut_archive(QFile &file, ArchiveLayout layout, std::size_t first, std::size_t last, const QString &target) {
+    if (first >= last)
+        return this->fail("Nothing would be left of the record");
+
+    ArchiveHeader &header = layout.header;
+    const std::size_t count = layout.blocks.size();
+    const quint64 metadataEnd = ArchiveHeader::HEADER_SIZE + header.metadataSize;
+    const quint64 start = layout.blocks[first].second;
+    const quint64 end = last < count ? layout.blocks[last].second : header.seekTableOffset;
+    const quint64 firstFrame = layout.blocks[first].first;
+    const quint64 endFrame = last < count ? layout.blocks[last].first : header.totalFrames;
+
+    //kept blocks follow metadata directly
+    std::vector<std::pair<quint64, quint64>> blocks(layout.blocks.begin() + first, layout.blocks.begin() + last);
+    for (auto &x : blocks) {
+        x.first -= firstFrame;
+        x.second = x.second - start + metadataEnd;
+    }
+    header.totalFrames = endFrame - firstFrame;
+    header.seekTableOffset = end - start + metadataEnd;
+    header.startTimestamp += static_cast<qint64>(firstFrame * 1000 / header.sampleRate);
+
+    QByteArray metadata;
+    if (file.seek(ArchiveHeader::HEADER_SIZE))
+        metadata = file.read(header.metadataSize);
+    if (metadata.size() != static_cast<int>(header.metadataSize))
+        return this->fail("Could not read " + path);
+    return this->save(file, target, {
+        { header.serialize() + metadata, static_cast<qint64>(start), static_cast<qint64>(end) },
+        { RecordEditor::serialize_seek_table(blocks), 0, 0 }
+    });
+}
+
+bool RecordEditor::split_archive(QFile &file, const ArchiveLayout &layout, qint64 positionMs, const QString &secondPath) {
+    const quint64 frame = static_cast<quint64>(std::max<qint64>(0, positionMs)) * layout.header.sampleRate / 1000;
+    if (frame == 0 || frame >= layout.header.totalFrames)
+        return this->fail("Split position is outside of the record");
+
+    //split at nearest block boundary
+    const std::size_t count = layout.blocks.size();
+    std::size_t position = static_cast<std::size_t>(std::lower_bound(layout.blocks.begin(), layout.blocks.end(), frame,
+        [](const std::pair<quint64, quint64> &block, quint64 value) { return block.first < value; }) - layout.blocks.begin());
+    if (position == count || (position > 0 && frame - layout.blocks[position - 1].first < layout.blocks[position].first - frame))
+        --position;
+    if (position == 0)
+        return this->fail("Split position is inside the first block");
+    if (!this->cut_archive(file, layout, position, count, secondPath))
+        return false;
+    if (this->cut_archive(file, layout, 0, position, path))
+        return true;
+    QFile::remove(secondPath);
+    return false;
+}
+
+
+
+
+
+bool RecordEditor::fail(const QString &message) {
+    errorString = message;
+    return false;
+}
+
+bool RecordEditor::save(QFile &source, const QString &target, const std::vector<Piece> &pieces) {
+    //record is replaced only by complete file, removed audio does not stay in it
+    QSaveFile output(target);
+    if (!output.open(QIODevice::WriteOnly))
+        return this->fail("Could not create " + target);
+    for (auto &piece : pieces)
+        if (output.write(piece.data) != piece.data.size() || !RecordEditor::copy_range(source, piece.from, piece.to, output))
+            return this->fail("Could not write " + target);
+    if (target == path)     //open file can not be replaced on windows
+        source.close();
+    if (!output.commit())
+        return this->fail("Could not write " + target);
+    return true;
+}
+
+bool RecordEditor::copy_range(QFile &source, qint64 from, qint64 to, QFileDevice &target) {
+    PooledBuffer buffer = BufferPool::instance().acquire();
+    if (buffer.is_null() || !source.seek(from))
+        return false;
+    while (from < to) {
+        const qint64 chunk = std::min<qint64>(to - from, buffer.capacity());
+        if (source.read(buffer.data(), chunk) != chunk || target.write(buffer.data(), chunk) != chunk)
+            return false;
+        from += chunk;
+    }
+    return true;
+}
+
+
+
+
+
+qint64 RecordEditor::find_cbr_frame(QFile &file, const MpegLayout &layout, std::size_t index) {
+    //padding keeps frame start within a byte of average position, next header must follow the frame
+    const bool end = index >= layout.count;
+    const std::size_t frame = end ? layout.count - 1 : index;
+    const qint64 estimate = layout.audioStart + static_cast<qint64>(frame * layout.frameBytes);
+    const qint64 from = std::max(layout.audioStart, estimate - CBR_SLACK);
+    const qint64 to = std::min(layout.audioEnd, estimate + CBR_SLACK + static_cast<qint64>(layout.frameBytes) + 2 + 4);
+    const uchar *data = to - from >= 4 ? file.map(from, to - from) : nullptr;
+    if (data == nullptr)
+        return -1;
+
+    qint64 best = -1;
+    int bestSize = 0;
+    MpegFrame header;
+    for (qint64 position = from; position + 4 <= to && position <= estimate + CBR_SLACK; ++position) {
+        const uchar *current = data + position - from;
+        if ((qFromBigEndian<quint32>(current) & CBR_HEADER_MASK) != layout.pattern || !RecordEditor::parse_mpeg_frame(current, header))
+            continue;
+        const qint64 following = position + header.size;
+        if (following > layout.audioEnd || (following < layout.audioEnd &&
+            (following + 4 > to || (qFromBigEndian<quint32>(data + following - from) & CBR_HEADER_MASK) != layout.pattern)))
+            continue;
+        if (best == -1 || qAbs(position - estimate) < qAbs(best - estimate)) {
+            best = position;
+            bestSize = header.size;
+        }
+    }
+    file.unmap(const_cast<uchar*>(data));
+
+    if (best == -1)
+        return -1;
+    return end ? best + bestSize : best;
+}
+
+bool RecordEditor::parse_mpeg_frame(const uchar *data, MpegFrame &frame) {
+    static const int BITRATES[5][15] = {
+        { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 },   //MPEG1 layer I
+        { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 },      //MPEG1 layer II
+        { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },       //MPEG1 layer III
+        { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256 },      //MPEG2 layer I
+        { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 }            //MPEG2 layer II, III
+    };
+    static const int SAMPLE_RATES[3] = { 44100, 48000, 32000 };
+
+    if (data[0] != 0xFF || (data[1] & 0xE0) != 0xE0)
+        return false;
+    const int version = (data[1] >> 3) & 3;         //0 MPEG2.5, 1 reserved, 2 MPEG2, 3 MPEG1
+    const int layer = 4 - ((data[1] >> 1) & 3);     //4 is reserved
+    const int bitrateIndex = data[2] >> 4;
+    const int rateIndex = (data[2] >> 2) & 3;
+    if (version == 1 || layer == 4 || bitrateIndex == 0 || bitrateIndex == 15 || rateIndex == 3)
+        return false; //free format bitrate is not supported either
+
+    const bool mpeg1 = version == 3;
+    const bool mono = (data[3] >> 6) == 3;
+    const int padding = (data[2] >> 1) & 1;
+    const int bitrate = BITRATES[mpeg1 ? layer - 1 : (layer == 1 ? 3 : 4)][bitrateIndex] * 1000;
+    frame.bitrate = bitrate;
+    frame.sampleRate = SAMPLE_RATES[rateIndex] >> (mpeg1 ? 0 : (version == 2 ? 1 : 2));
+    if (layer == 1) {
+        frame.samples = 384;
+        frame.size = (12 * bitrate / frame.sampleRate + padding) * 4;
+    } else {
+        frame.samples = layer == 3 && !mpeg1 ? 576 : 1152;
+        frame.size = frame.samples / 8 * bitrate / frame.sampleRate + padding;
+    }
+    frame.sideInfo = mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17);
+    return frame.size > 4;
+}
+
+QByteArray RecordEditor::update_info_frame(QByteArray frame, quint32 frames, quint32 bytes) {
+    MpegFrame header;
+    uchar *data = reinterpret_cast<uchar*>(frame.data());
+    if (!RecordEditor::parse_mpeg_frame(data, header))
+        return frame;
+    int position = 4 + header.sideInfo;
+    const quint32 flags = qFromBigEndian<quint32>(data + position + 4);
+    position += 8;
+    const int lame = position + (flags & 1 ? 4 : 0) + (flags & 2 ? 4 : 0) + (flags & 4 ? 100 : 0) + (flags & 8 ? 4 : 0);
+    if (lame > frame.size())
+        return frame;
+
+    //LAME tag checksum is refreshed only when it was valid before
+    const int crcPosition = lame + 34;
+    const bool crc = crcPosition + 2 <= frame.size() && RecordEditor::crc16(data, crcPosition) == qFromBigEndian<quint16>(data + crcPosition);
+    if (flags & 1) {
+        qToBigEndian(frames, data + position);
+        position += 4;
+    }
+    if (flags & 2) {
+        qToBigEndian(bytes, data + position);
+        position += 4;
+    }
+    if (flags & 4) //linear seek table, exact for constant bitrate
+        for (int i = 0; i < 100; ++i)
+            data[position + i] = static_cast<uchar>(i * 256 / 100);
+    if (crc)
+        qToBigEndian(RecordEditor::crc16(data, crcPosition), data + crcPosition);
+    return frame;
+}
+
+QByteArray RecordEditor::serialize_seek_table(const std::vector<std::pair<quint64, quint64>> &blocks) {
+    QByteArray table;
+    table.reserve(4 + ArchiveHeader::SEEK_ENTRY_SIZE * static_cast<int>(blocks.size()));
+    uchar entry[ArchiveHeader::SEEK_ENTRY_SIZE];
+    qToLittleEndian(static_cast<quint32>(blocks.size()), entry);
+    table.append(reinterpret_cast<const char*>(entry), 4);
+    for (auto &x : blocks) {
+        qToLittleEndian(x.first, entry);
+        qToLittleEndian(x.second, entry + 8);
+        table.append(reinterpret_cast<const char*>(entry), ArchiveHeader::SEEK_ENTRY_SIZE);
+    }
+    return table;
+}
+
+quint16 RecordEditor::crc16(const uchar *data, int size) {
+    quint16 crc = 0;
+    for (int i = 0; i < size; ++i) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit)
+            crc = static_cast<quint16>(crc & 1 ? (crc >> 1) ^ 0xA001 : crc >> 1);
+    }
+    return crc;
+}
+
+const int RecordEditor::ID3_HEADER_SIZE = 10;
+const quint32 RecordEditor::CBR_HEADER_MASK = 0xFFFFFC00;
+const qint64 RecordEditor::CBR_SLACK = 4;
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QFile>
+#include <vector>
+#include "wavformat.hpp"
+#include "archiveformat.hpp"
+
+//trims and splits records without decoding, kept part is copied to a temporary file which then replaces the record,
+//so removed audio is gone and an interrupted edit leaves the record untouched
+//  wav      cut at sample frames, chunks in front of data are kept
+//  mp3      cut at frame boundaries, tags are kept, Xing/Info frame is updated;
+//           constant bitrate frames are found by arithmetic, variable bitrate stream needs a scan of all frame headers
+//  archive  cut at block boundaries, seek table is rewritten
+class RecordEditor {
+public:
+    RecordEditor(const QString &path);
+
+    bool trim(qint64 startMs, qint64 endMs);                    //keeps [start, end), negative end keeps the rest
+    bool split(qint64 positionMs, const QString &secondPath);  //part after position is moved to second file
+    QString error_string() const;
+private:
+    enum Format { Unknown, Wav, Mpeg, Archive };
+
+    struct MpegFrame {
+        int size;
+        int samples;
+        int sampleRate;
+        int bitrate;
+        int sideInfo;
+    };
+
+    struct MpegLayout {
+        qint64 tagEnd;              //end of leading ID3v2 tag, 0 without tag
+        qint64 audioEnd;            //start of trailing ID3v1 tag
+        QByteArray info;            //Xing/Info frame, empty without one
+        qint64 infoOffset;
+        int samples;
+        int sampleRate;
+        std::size_t count;          //audio frames
+        qint64 audioStart;          //first audio frame
+        double frameBytes;          //average frame size of constant bitrate stream, 0 when frames are listed
+        quint32 pattern;            //header bits shared by all frames of constant bitrate stream
+        std::vector<qint64> frames; //listed audio frame offsets, last value is end of the last frame
+    };
+
+    struct ArchiveLayout {
+        ArchiveHeader header;
+        std::vector<std::pair<quint64, quint64>> blocks;    //first frame, offset
+    };
+
+    struct Piece {
+        QByteArray data;    //written first
+        qint64 from;        //followed by bytes [from, to) of the record
+        qint64 to;
+    };
+
+    Format detect(QFile &file) const;
+
+    bool cut_wav(QFile &file, const WavFormat &wav, qint64 first, qint64 last, const QString &target);
+    bool split_wav(QFile &file, qint64 positionMs, const QString &secondPath);
+
+    bool read_mpeg(QFile &file, MpegLayout &layout);
+    bool scan_mpeg(QFile &file, MpegLayout &layout);
+    bool mpeg_frame(QFile &file, MpegLayout &layout, std::size_t &index, qint64 &offset);   //index past the end is clamped
+    bool cut_mpeg(QFile &file, MpegLayout &layout, std::size_t first, std::size_t last, const QString &target);
+    bool split_mpeg(QFile &file, MpegLayout &layout, qint64 positionMs, const QString &secondPath);
+
+    bool read_archive(ArchiveLayout &layout);
+    bool cut_archive(QFile &file, ArchiveLayout layout, std::size_t first, std::size_t last, const QString &target);
+    bool split_archive(QFile &file, const ArchiveLayout &layout, qint64 positionMs, const QString &secondPath);
+
+    bool save(QFile &source, const QString &target, const std::vector<Piece> &pieces);
+    bool fail(const QString &message);
+
+    static bool copy_range(QFile &source, qint64 from, qint64 to, QFileDevice &target);
+
+    static qint64 find_cbr_frame(QFile &file, const MpegLayout &layout, std::size_t index);    //-1 when not found
+    static bool parse_mpeg_frame(const uchar *data, MpegFrame &frame);
+    static QByteArray update_info_frame(QByteArray frame, quint32 frames, quint32 bytes);
+    static QByteArray serialize_seek_table(const std::vector<std::pair<quint64, quint64>> &blocks);
+    static quint16 crc16(const uchar *data, int size);
+
+    QString path;
+    QString errorString;
+
+    static const int ID3_HEADER_SIZE;
+    static const quint32 CBR_HEADER_MASK;
+    static const qint64 CBR_SLACK;
+};
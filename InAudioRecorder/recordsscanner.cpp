@@ -0,0 +1,254 @@
+#include "stdafx.h"
+#include "recordsscanner.hpp"
+#include "wavformat.hpp"
+#include <cmath>
+
+RecordsScanner::RecordsScanner(const QString &path, QObject *parent)
+    : QObject(parent)
+    , directory(path)
+    , cachePath(directory.absolutePath() + ".fingerprints")
+    , cache()
+    , done(0) {
+    this->load_cache();
+}
+
+RecordsScanner::~RecordsScanner() {}
+
+RecordsScanner::Report RecordsScanner::scan() {
+    struct Task {
+        QFileInfo info;
+        Fingerprint result;
+    };
+
+    Report report{ {}, {}, {}, 0, 0 };
+    QFileInfoList files = directory.entryInfoList(QDir::Files | QDir::NoDotAndDotDot, QDir::Name);
+    report.scanned = files.size();
+
+    //only new or modified files are read, everything else comes from cache
+    QVector<Task> tasks;
+    for (auto &info : files) {
+        auto pos = cache.constFind(info.fileName());
+        if (pos == cache.constEnd() || pos->size != info.size() ||
+            pos->modified != info.lastModified().toMSecsSinceEpoch())
+            tasks.append({ info, Fingerprint() });
+    }
+    report.fingerprinted = tasks.size();
+
+    done = report.scanned - report.fingerprinted;
+    emit progress(done, report.scanned);
+    QtConcurrent::blockingMap(tasks, [this, &report](Task &task) {
+        task.result = RecordsScanner::fingerprint(task.info);
+        emit progress(++done, report.scanned);
+    });
+
+    QHash<QString, Fingerprint> current;
+    current.reserve(files.size());
+    for (auto &info : files)
+        current.insert(info.fileName(), cache.value(info.fileName()));
+    for (auto &task : tasks)
+        current.insert(task.info.fileName(), task.result);
+    cache.swap(current);
+    this->save_cache();
+
+
+    //exact duplicates
+    QHash<QByteArray, QStringList> byHash;
+    QStringList order;
+    for (auto &info : files) {
+        const Fingerprint &print = cache[info.fileName()];
+        if (print.contentHash.isEmpty())
+            continue;
+        QStringList &group = byHash[print.contentHash];
+        if (group.isEmpty())
+            order.append(info.fileName());
+        group.append(info.fileName());
+    }
+    for (auto &first : order) {
+        const QStringList &group = byHash[cache[first].contentHash];
+        if (group.size() > 1)
+            report.duplicates.append(group);
+    }
+
+    //silent and near duplicates, one representative per exact duplicate group
+    std::vector<QString> candidates;
+    for (auto &name : order) {
+        const Fingerprint &print = cache[name];
+        if (RecordsScanner::is_silent(print))
+            report.silent.append(byHash[print.contentHash]);
+        else if (!print.energy.isEmpty())
+            candidates.push_back(name);
+    }
+    std::vector<bool> grouped(candidates.size(), false);
+    for (std::size_t i = 0; i < candidates.size(); ++i) {
+        if (grouped[i])
+            continue;
+        QStringList group(candidates[i]);
+        for (std::size_t j = i + 1; j < candidates.size(); ++j)
+            if (!grouped[j] && RecordsScanner::is_similar(cache[candidates[i]], cache[candidates[j]])) {
+                grouped[j] = true;
+                group.append(candidates[j]);
+            }
+        if (group.size() > 1)
+            report.similar.append(group);
+    }
+    report.silent.sort();
+
+    return report;
+}
+
+int RecordsScanner::remove_redundant(const Report &report, int flags, const QString &keep) const {
+    QSet<QString> redundant;
+    //first file of every group is kept
+    if (flags & Duplicates)
+        for (auto &group : report.duplicates)
+            for (int i = 1; i < group.size(); ++i)
+                redundant.insert(group[i]);
+    if (flags & Similar)
+        for (auto &group : report.similar)
+            for (int i = 1; i < group.size(); ++i)
+                redundant.insert(group[i]);
+    if (flags & Silent)
+        for (auto &name : report.silent)
+            redundant.insert(name);
+
+    QString keepPath = QFileInfo(keep).absoluteFilePath();
+    int removed = 0;
+    for (auto &name : redundant) {
+        QString path = directory.absoluteFilePath(name);
+        if (path != keepPath && QFile(path).remove())
+            ++removed;
+    }
+    return removed;
+}
+
+QString RecordsScanner::describe(const Report &report) {
+    QString text = QString("Scanned %1 records (%2 fingerprinted).\n")
+        .arg(report.scanned)
+        .arg(report.fingerprinted);
+    for (auto &group : report.duplicates)
+        text += "Duplicate: " + group.join(", ") + "\n";
+    for (auto &group : report.similar)
+        text += "Similar: " + group.join(", ") + "\n";
+    for (auto &name : report.silent)
+        text += "Silent: " + name + "\n";
+    return text;
+}
+
+
+
+
+
+RecordsScanner::Fingerprint RecordsScanner::fingerprint(const QFileInfo &info) {
+    Fingerprint print{ info.size(), info.lastModified().toMSecsSinceEpoch(), QByteArray(), QByteArray() };
+    QFile file(info.absoluteFilePath());
+    if (!file.open(QIODevice::ReadOnly))
+        return print;
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    QByteArray buffer(static_cast<int>(CHUNK_SIZE), Qt::Uninitialized);
+    qint64 read;
+    while ((read = file.read(buffer.data(), CHUNK_SIZE)) > 0)
+        hash.addData(buffer.constData(), static_cast<int>(read));
+    print.contentHash = hash.result();
+    print.energy = RecordsScanner::energy_signature(file);
+    return print;
+}
+
+QByteArray RecordsScanner::energy_signature(QFile &file) {
+    WavFormat format;
+    if (!WavFormat::read(file, format) || !format.is_supported() || !file.seek(format.dataOffset))
+        return QByteArray();
+
+    QByteArray signature;
+    if (format.frames() == 0)
+        return QByteArray(1, static_cast<char>(static_cast<qint8>(-120)));
+
+    const qint64 chunkFrames = std::max<qint64>(CHUNK_SIZE / format.blockAlign, 1);
+    QByteArray buffer(static_cast<int>(chunkFrames * format.blockAlign), Qt::Uninitialized);
+    qint64 remaining = format.frames();
+    while (remaining > 0) {
+        qint64 secondFrames = std::min<qint64>(remaining, format.sampleRate);
+        double sum = 0.0;
+        for (qint64 left = secondFrames; left > 0;) {
+            qint64 frames = std::min(left, chunkFrames);
+            qint64 read = file.read(buffer.data(), frames * format.blockAlign);
+            if (read < format.blockAlign)
+                return signature;
+            frames = read / format.blockAlign;
+            double rms = format.rms(buffer.constData(), frames);
+            sum += rms * rms * frames;
+            left -= frames;
+        }
+        double rms = std::sqrt(sum / secondFrames);
+        double db = rms > 0.0 ? 20.0 * std::log10(rms) : -120.0;
+        signature.append(static_cast<char>(static_cast<qint8>(qBound(-120, static_cast<int>(std::lround(db)), 0))));
+        remaining -= secondFrames;
+    }
+    return signature;
+}
+
+bool RecordsScanner::is_silent(const Fingerprint &fingerprint) {
+    if (fingerprint.size == 0)
+        return true;
+    if (fingerprint.energy.isEmpty())
+        return false;
+    for (int i = 0; i < fingerprint.energy.size(); ++i)
+        if (RecordsScanner::energy_at(fingerprint.energy, i) >= SILENCE_DB)
+            return false;
+    return true;
+}
+
+bool RecordsScanner::is_similar(const Fingerprint &left, const Fingerprint &right) {
+    int length = std::min(left.energy.size(), right.energy.size());
+    if (length < 2 || std::abs(left.energy.size() - right.energy.size()) > 1)
+        return false;
+    int difference = 0;
+    for (int i = 0; i < length; ++i)
+        difference += std::abs(RecordsScanner::energy_at(left.energy, i) - RecordsScanner::energy_at(right.energy, i));
+    return difference <= SIMILARITY_DB * length;
+}
+
+int RecordsScanner::energy_at(const QByteArray &energy, int index) {
+    //char is unsigned on some platforms, values are signed bytes also in the cache file
+    return static_cast<qint8>(energy.at(index));
+}
+
+
+
+
+
+void RecordsScanner::load_cache() {
+    QFile file(cachePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+    QDataStream stream(&file);
+    quint32 magic, version;
+    qint32 count;
+    stream >> magic >> version >> count;
+    if (magic != 0x49524650 || version != 1 || count < 0)
+        return;
+    cache.reserve(count);
+    for (qint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString name;
+        Fingerprint print;
+        stream >> name >> print.size >> print.modified >> print.contentHash >> print.energy;
+        cache.insert(name, print);
+    }
+    if (stream.status() != QDataStream::Ok)
+        cache.clear();
+}
+
+void RecordsScanner::save_cache() const {
+    QSaveFile file(cachePath);
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+    QDataStream stream(&file);
+    stream << quint32(0x49524650) << quint32(1) << qint32(cache.size());
+    for (auto it = cache.constBegin(); it != cache.constEnd(); ++it)
+        stream << it.key() << it->size << it->modified << it->contentHash << it->energy;
+    file.commit();
+}
+
+const qint64 RecordsScanner::CHUNK_SIZE = 64 * 1024;
+const int RecordsScanner::SILENCE_DB = -60;
+const int RecordsScanner::SIMILARITY_DB = 3;
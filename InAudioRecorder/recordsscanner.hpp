@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <atomic>
+
+class RecordsScanner : public QObject {
+    Q_OBJECT
+public:
+    struct Fingerprint {
+        qint64 size;
+        qint64 modified;        //msecs since epoch, cache key together with size
+        QByteArray contentHash;
+        QByteArray energy;      //one qint8 dBFS value per second, empty if format is not decodable
+    };
+
+    struct Report {
+        QList<QStringList> duplicates;  //identical content, first file is kept
+        QList<QStringList> similar;     //near identical energy signature, first file is kept
+        QStringList silent;
+        int scanned;
+        int fingerprinted;              //files that were not found in cache
+    };
+
+    enum CleanupFlag {
+        Duplicates = 0x1,
+        Similar = 0x2,
+        Silent = 0x4
+    };
+
+    RecordsScanner(const QString &path, QObject *parent = nullptr);
+    ~RecordsScanner();
+
+    Report scan();
+    int remove_redundant(const Report &report, int flags, const QString &keep = "") const;
+
+    static QString describe(const Report &report);
+signals:
+    void progress(int done, int total);
+private:
+    static Fingerprint fingerprint(const QFileInfo &info);
+    static QByteArray energy_signature(QFile &file);
+    static bool is_silent(const Fingerprint &fingerprint);
+    static bool is_similar(const Fingerprint &left, const Fingerprint &right);
+    static int energy_at(const QByteArray &energy, int index);
+
+    void load_cache();
+    void save_cache() const;
+
+    QDir directory;
+    QString cachePath;
+    QHash<QString, Fingerprint> cache;
+    std::atomic<int> done;
+
+    static const qint64 CHUNK_SIZE;
+    static const int SILENCE_DB;
+    static const int SIMILARITY_DB;
+};
@@ -1,3 +1,4 @@
 #include <QtWidgets>
 #include <QtCore>
+#include <QtConcurrent>
 #include <iostream>
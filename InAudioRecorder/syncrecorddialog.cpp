@@ -0,0 +1,86 @@
+#include "stdafx.h"
+#include "syncrecorddialog.hpp"
+
+
+
+SyncRecordDialog::SyncRecordDialog(QWidget *parent, SyncRecorder *_recorder, const QString &_path)
+	: QDialog(parent)
+	, recorder(_recorder)
+	, devices(QAudioDeviceInfo::availableDevices(QAudio::AudioInput))
+	, path(_path) {
+	this->setupUi(this);
+	this->setWindowFlags(this->windowFlags() & ~Qt::WindowContextHelpButtonHint);
+	this->setWindowTitle("Synchronized recording");
+
+	for (auto &x : devices) {
+		QListWidgetItem *item = new QListWidgetItem(x.deviceName(), devicesList);
+		item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+		item->setCheckState(Qt::Unchecked);
+	}
+	for (int x : { 44100, 48000, 96000 })
+		sampleRate->addItem(QString::number(x / 1000.0) + "kHz", x);
+	sampleRate->setCurrentIndex(1);
+
+	statisticsTable->setColumnCount(5);
+	statisticsTable->setHorizontalHeaderLabels({ "Device", "Drift [ppm]", "Ratio", "Offset [frames]", "Frames out" });
+	statisticsTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+	statisticsTable->verticalHeader()->hide();
+
+	QObject::connect(recordButton, &QPushButton::clicked, this, &SyncRecordDialog::record);
+	QObject::connect(recorder, &SyncRecorder::statistics_updated, this, &SyncRecordDialog::update_statistics);
+	QObject::connect(recorder, &SyncRecorder::failed, this, &SyncRecordDialog::update_controls);
+	this->update_controls();
+	this->update_statistics();
+}
+
+SyncRecordDialog::~SyncRecordDialog() {}
+
+void SyncRecordDialog::record() {
+	if (recorder->is_running()) {
+		recorder->stop();
+		if (!recorder->error_string().isEmpty())
+			QMessageBox::critical(this, "Recording error", recorder->error_string());
+		this->update_controls();
+		return;
+	}
+
+	QList<QAudioDeviceInfo> selected;
+	for (int i = 0; i < devicesList->count(); ++i)
+		if (devicesList->item(i)->checkState() == Qt::Checked)
+			selected.append(devices[i]);
+	if (!recorder->start(selected, sampleRate->currentData().toInt(), QDir(path)))
+		QMessageBox::critical(this, "Recording error", recorder->error_string());
+	this->update_controls();
+}
+
+void SyncRecordDialog::update_statistics() {
+	const QVector<SyncStream::Statistics> &statistics = recorder->get_statistics();
+	statisticsTable->setRowCount(statistics.size());
+	for (int i = 0; i < statistics.size(); ++i) {
+		const SyncStream::Statistics &x = statistics[i];
+		const QStringList cells = {
+			x.device,
+			QString::number(x.driftPpm, 'f', 1),
+			QString::number(x.ratio, 'f', 6),
+			QString::number(x.alignmentError, 'f', 1),
+			QString::number(x.framesOut)
+		};
+		for (int column = 0; column < cells.size(); ++column)
+			statisticsTable->setItem(i, column, new QTableWidgetItem(cells[column]));
+	}
+	this->update_controls();
+}
+
+void SyncRecordDialog::update_controls() {
+	bool running = recorder->is_running();
+	recordButton->setText(running ? "Stop" : "Record");
+	devicesList->setEnabled(!running);
+	sampleRate->setEnabled(!running);
+	BufferPool::Statistics pool = BufferPool::instance().get_statistics();
+	QString status = "Status: <font color=\"blue\">Stopped</font>";
+	if (running)
+		status = "Status: <font color=\"green\">Recording</font>";
+	else if (!recorder->error_string().isEmpty())
+		status = "Status: <font color=\"red\">" + recorder->error_string().toHtmlEscaped() + "</font>";
+	statusLabel->setText(status + QString("  Buffers: %1/%2").arg(pool.inUse).arg(pool.blocks));
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <QDialog>
+#include "syncrecorder.hpp"
+#include "ui_syncrecorddialog.h"
+
+class SyncRecordDialog : public QDialog, public Ui::SyncRecordDialog {
+	Q_OBJECT
+public:
+	SyncRecordDialog(QWidget *parent, SyncRecorder *recorder, const QString &path);
+	~SyncRecordDialog();
+private slots:
+	void record();
+	void update_statistics();
+private:
+	void update_controls();
+
+	SyncRecorder *recorder;
+	QList<QAudioDeviceInfo> devices;
+	QString path;
+};
@@ -0,0 +1,157 @@
+#include "stdafx.h"
+#include "syncrecorder.hpp"
+
+SyncRecorder::SyncRecorder(const DiskMonitor *_diskMonitor, QObject *parent)
+    : QObject(parent)
+    , diskMonitor(_diskMonitor)
+    , directory()
+    , bytesPerSecond(0)
+    , streams()
+    , statistics()
+    , clock()
+    , statisticsTimer(new QTimer(this))
+    , errorString()
+    , running(false) {
+    statisticsTimer->setInterval(1000);
+    QObject::connect(statisticsTimer, &QTimer::timeout, this, &SyncRecorder::check);
+}
+
+SyncRecorder::~SyncRecorder() {
+    this->stop();
+}
+
+bool SyncRecorder::start(const QList<QAudioDeviceInfo> &devices, int sampleRate, const QDir &directory) {
+    if (running)
+        return false;
+    errorString.clear();
+    if (devices.isEmpty()) {
+        errorString = "No input devices selected.";
+        return false;
+    }
+    if (!directory.exists() && !directory.mkpath(".")) {
+        errorString = "Could not create directory for output files.";
+        return false;
+    }
+    if (!diskMonitor->has_space(directory.absolutePath())) {
+        errorString = "Not enough free disk space to start recording.";
+        return false;
+    }
+    this->directory = directory.absolutePath();
+    bytesPerSecond = 0;
+
+    QString session = QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss");
+    clock.start(); //monotonic, shared by all streams
+    for (int i = 0; i < devices.size(); ++i) {
+        QAudioFormat format;
+        format.setSampleRate(sampleRate);
+        format.setChannelCount(2);
+        format.setSampleSize(16);
+        format.setSampleType(QAudioFormat::SignedInt);
+        format.setByteOrder(QAudioFormat::LittleEndian);
+        format.setCodec("audio/pcm");
+        if (!devices[i].isFormatSupported(format))
+            format = devices[i].nearestFormat(format);
+        if (format.sampleSize() != 16 || format.sampleType() != QAudioFormat::SignedInt ||
+            format.byteOrder() != QAudioFormat::LittleEndian || format.channelCount() <= 0) {
+            errorString = devices[i].deviceName() + " does not support 16 bit pcm.";
+            this->stop();
+            return false;
+        }
+
+        QString path = directory.absoluteFilePath(QString("sync_%1_%2.wav").arg(session).arg(i + 1));
+        streams.emplace_back(new SyncStream(devices[i], format, sampleRate, path));
+        bytesPerSecond += static_cast<qint64>(sampleRate) * format.channelCount() * 2;
+        //stream error is handled after its callback returns, stopping there would delete the stream
+        auto failed = [this] { QTimer::singleShot(0, this, &SyncRecorder::check); };
+        if (!streams.back()->start(this, [this] { return clock.nsecsElapsed(); }, failed)) {
+            errorString = streams.back()->error_string();
+            this->stop();
+            return false;
+        }
+    }
+
+    running = true;
+    statisticsTimer->start();
+    this->update_statistics();
+    return true;
+}
+
+void SyncRecorder::stop() {
+    statisticsTimer->stop();
+    if (!streams.empty())
+        this->update_statistics();
+    for (auto &stream : streams)
+        if (!stream->stop() && errorString.isEmpty())
+            errorString = stream->error_string();
+    streams.clear();
+    running = false;
+}
+
+bool SyncRecorder::is_running() const {
+    return running;
+}
+
+QString SyncRecorder::error_string() const {
+    return errorString;
+}
+
+const QVector<SyncStream::Statistics> &SyncRecorder::get_statistics() const {
+    return statistics;
+}
+
+QJsonArray SyncRecorder::get_statistics_json() const {
+    QJsonArray array;
+    for (auto &x : statistics)
+        array.append(QJsonObject{
+            { "device", x.device },
+            { "file", x.file },
+            { "nominalRate", x.nominalRate },
+            { "measuredRate", x.measuredRate },
+            { "driftPpm", x.driftPpm },
+            { "ratio", x.ratio },
+            { "alignmentError", x.alignmentError },
+            { "framesIn", x.framesIn },
+            { "framesOut", x.framesOut }
+        });
+    return array;
+}
+
+
+
+
+
+void SyncRecorder::check() {
+    //one failed stream or full disk ends the whole session, files stay aligned up to that point
+    if (!running)
+        return;
+    QString error;
+    for (auto &stream : streams)
+        if (!stream->error_string().isEmpty()) {
+            error = stream->error_string();
+            break;
+        }
+    if (error.isEmpty() && this->disk_full())
+        error = "Disk is almost full, synchronized recording stopped.";
+    if (error.isEmpty()) {
+        this->update_statistics();
+        return;
+    }
+    errorString = error;
+    this->stop();
+    emit failed(error);
+}
+
+bool SyncRecorder::disk_full() const {
+    //aligned files can not be continued elsewhere, fallback level stops the session
+    if (!diskMonitor->has_space(directory))
+        return true;
+    QStorageInfo storage(directory);
+    return storage.isValid() && storage.bytesAvailable() < bytesPerSecond * diskMonitor->get_thresholds().fallbackSeconds;
+}
+
+void SyncRecorder::update_statistics() {
+    statistics.clear();
+    for (auto &stream : streams)
+        statistics.append(stream->get_statistics());
+    emit statistics_updated();
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include "syncstream.hpp"
+#include "diskmonitor.hpp"
+
+class SyncRecorder : public QObject {
+    Q_OBJECT
+public:
+    SyncRecorder(const DiskMonitor *diskMonitor, QObject *parent = nullptr);
+    ~SyncRecorder();
+
+    bool start(const QList<QAudioDeviceInfo> &devices, int sampleRate, const QDir &directory);
+    void stop();
+
+    bool is_running() const;
+    QString error_string() const;
+    const QVector<SyncStream::Statistics> &get_statistics() const;
+    QJsonArray get_statistics_json() const;
+signals:
+    void statistics_updated();
+    void failed(const QString &message);   //session was stopped because of stream error or full disk
+private slots:
+    void check();
+    void update_statistics();
+private:
+    bool disk_full() const;
+
+    const DiskMonitor *diskMonitor;
+    QString directory;
+    qint64 bytesPerSecond;
+    std::vector<std::unique_ptr<SyncStream>> streams;
+    QVector<SyncStream::Statistics> statistics;
+    QElapsedTimer clock;
+    QTimer *statisticsTimer;
+    QString errorString;
+    bool running;
+};
@@ -0,0 +1,224 @@
+#include "stdafx.h"
+#include "syncstream.hpp"
+#include <cmath>
+#include <cstring>
+
+SyncStream::SyncStream(const QAudioDeviceInfo &_device, const QAudioFormat &_format, int _outputRate, const QString &path)
+    : device(_device)
+    , format(_format)
+    , input()
+    , source(nullptr)
+    , file(path)
+    , wav{
+        WavFormat::PCM, static_cast<quint16>(_format.channelCount()), static_cast<quint32>(_outputRate),
+        static_cast<quint16>(_format.channelCount() * 2), 16, WavFormat::HEADER_SIZE, 0
+    }
+    , errorString()
+    , clock()
+    , failed()
+    , pending()
+    , previous(_format.channelCount(), 0)
+    , phase(0.0)
+    , ratio(static_cast<double>(_outputRate) / _format.sampleRate())
+    , nominalRate(_format.sampleRate())
+    , outputRate(_outputRate)
+    , weight(0.0)
+    , meanTime(0.0)
+    , meanFrames(0.0)
+    , varianceTime(0.0)
+    , covariance(0.0)
+    , measuredRate(_format.sampleRate())
+    , alignmentError(0.0)
+    , framesIn(0)
+    , framesOut(0)
+    , firstBuffer(0) {}
+
+SyncStream::~SyncStream() {
+    this->stop();
+}
+
+bool SyncStream::start(QObject *context, const std::function<qint64()> &_clock, const std::function<void()> &_failed) {
+    clock = _clock;
+    failed = _failed;
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(wav.serialize()) != WavFormat::HEADER_SIZE) {
+        errorString = "Could not create " + file.fileName();
+        return false;
+    }
+
+    input.reset(new QAudioInput(device, format));
+    input->setBufferSize(format.bytesForDuration(100000));
+    source = input->start();
+    if (source == nullptr) {
+        errorString = "Could not open " + device.deviceName();
+        return false;
+    }
+    QObject::connect(source, &QIODevice::readyRead, context, [this] {
+        this->process(clock());
+    });
+    return true;
+}
+
+bool SyncStream::stop() {
+    if (!file.isOpen())
+        return false;
+    if (input) {
+        if (source != nullptr)
+            this->process(clock());
+        input->stop();
+        source = nullptr;
+    }
+    bool ok = file.seek(0) && file.write(wav.serialize()) == WavFormat::HEADER_SIZE;
+    file.close();
+    return ok;
+}
+
+QString SyncStream::error_string() const {
+    return errorString;
+}
+
+SyncStream::Statistics SyncStream::get_statistics() const {
+    return Statistics{
+        device.deviceName(),
+        file.fileName(),
+        nominalRate,
+        measuredRate,
+        (measuredRate / nominalRate - 1.0) * 1e6,
+        ratio,
+        alignmentError,
+        framesIn,
+        framesOut
+    };
+}
+
+
+
+
+
+void SyncStream::process(qint64 now) {
+    const int frameBytes = format.bytesPerFrame();
+    const qint64 before = framesIn;
+    if (pending.is_null())
+        pending = BufferPool::instance().acquire();
+    PooledBuffer output = BufferPool::instance().acquire();
+    if (pending.is_null() || output.is_null()) {
+        this->fail("Buffer pool exhausted");
+        return;
+    }
+
+    //slices are limited so resampled output always fits one block
+    while (source != nullptr) {
+        qint64 read = source->read(pending.data() + pending.size(), this->input_limit() * frameBytes - pending.size());
+        if (read <= 0)
+            break;
+        pending.set_size(pending.size() + static_cast<int>(read));
+        const qint64 frames = pending.size() / frameBytes;
+        if (frames == 0)
+            continue;
+        const qint16 *samples = reinterpret_cast<const qint16*>(pending.data()); //little endian pcm
+
+        if (framesIn == 0) {
+            //silence up to the capture of first frame, every file starts at the same clock instant
+            double captured = now / 1e9 - (frames + source->bytesAvailable() / frameBytes) / nominalRate;
+            std::copy(samples, samples + wav.channels, previous.begin());
+            firstBuffer = now;
+            if (!this->write_silence(std::max<qint64>(0, std::llround(captured * outputRate))))
+                return;
+        }
+        framesIn += frames;
+        this->resample(samples, frames, output);
+        int rest = pending.size() - static_cast<int>(frames * frameBytes);
+        std::memmove(pending.data(), pending.data() + frames * frameBytes, static_cast<std::size_t>(rest));
+        pending.set_size(rest);
+        if (!this->write_output(output))
+            return;
+    }
+    if (framesIn == before)
+        return;
+    this->estimate(now);
+
+    //output frames that should exist at this instant of the shared clock
+    double error = now / 1e9 * outputRate - framesOut;
+    alignmentError = before == 0 ? error : 0.98 * alignmentError + 0.02 * error;
+    double correction = qBound(-MAX_CORRECTION, alignmentError / (outputRate * CORRECTION_SECONDS), MAX_CORRECTION);
+    ratio = outputRate / measuredRate * (1.0 + correction);
+}
+
+void SyncStream::estimate(qint64 now) {
+    double time = (now - firstBuffer) / 1e9;
+    double frames = static_cast<double>(framesIn);
+
+    weight = FORGETTING * weight + 1.0;
+    double deltaTime = time - meanTime;
+    meanTime += deltaTime / weight;
+    meanFrames += (frames - meanFrames) / weight;
+    varianceTime = FORGETTING * varianceTime + deltaTime * (time - meanTime);
+    covariance = FORGETTING * covariance + deltaTime * (frames - meanFrames);
+
+    //slope is the device rate measured against the monotonic clock
+    if (time >= WARMUP_SECONDS && varianceTime > 0.0)
+        measuredRate = covariance / varianceTime;
+}
+
+void SyncStream::resample(const qint16 *samples, qint64 frames, PooledBuffer &output) {
+    //linear interpolation, phase is position between previous and current input frame
+    const int channels = wav.channels;
+    const double step = 1.0 / ratio;
+    qint16 *target = reinterpret_cast<qint16*>(output.data());
+    qint16 *written = target;
+    for (qint64 i = 0; i < frames; ++i) {
+        const qint16 *current = samples + i * channels;
+        for (; phase < 1.0; phase += step)
+            for (int channel = 0; channel < channels; ++channel)
+                *written++ = static_cast<qint16>(std::lround(previous[channel] + (current[channel] - previous[channel]) * phase));
+        phase -= 1.0;
+        std::copy(current, current + channels, previous.begin());
+    }
+    output.set_size(static_cast<int>((written - target) * sizeof(qint16)));
+}
+
+bool SyncStream::write_output(const PooledBuffer &output) {
+    qint64 bytes = output.size();
+    if (file.write(output.data(), bytes) != bytes) {
+        this->fail("Could not write " + file.fileName());
+        return false;
+    }
+    framesOut += bytes / wav.blockAlign;
+    wav.dataSize += bytes;
+    return true;
+}
+
+bool SyncStream::write_silence(qint64 frames) {
+    PooledBuffer silence = BufferPool::instance().acquire();
+    if (silence.is_null()) {
+        this->fail("Buffer pool exhausted");
+        return false;
+    }
+    const qint64 blockFrames = silence.capacity() / wav.blockAlign;
+    std::memset(silence.data(), 0, static_cast<std::size_t>(blockFrames * wav.blockAlign));
+    for (; frames > 0; frames -= blockFrames) {
+        silence.set_size(static_cast<int>(std::min(frames, blockFrames) * wav.blockAlign));
+        if (!this->write_output(silence))
+            return false;
+    }
+    return true;
+}
+
+qint64 SyncStream::input_limit() const {
+    //at most frames * ratio + 1 frames come out of resample
+    qint64 inputFrames = BufferPool::BLOCK_SIZE / format.bytesPerFrame();
+    qint64 outputFrames = static_cast<qint64>((BufferPool::BLOCK_SIZE / wav.blockAlign - 2) / ratio);
+    return std::max<qint64>(1, std::min(inputFrames, outputFrames));
+}
+
+void SyncStream::fail(const QString &message) {
+    errorString = message;
+    input->stop();
+    source = nullptr;
+    if (failed)
+        failed();
+}
+
+const double SyncStream::FORGETTING = 0.9995;
+const double SyncStream::WARMUP_SECONDS = 2.0;
+const double SyncStream::CORRECTION_SECONDS = 10.0;
+const double SyncStream::MAX_CORRECTION = 0.0005;
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QAudioInput>
+#include <QAudioDeviceInfo>
+#include <QFile>
+#include <memory>
+#include <functional>
+#include "wavformat.hpp"
+#include "bufferpool.hpp"
+
+//one device of synchronized recording, output is resampled to the shared monotonic clock
+class SyncStream {
+public:
+    struct Statistics {
+        QString device;
+        QString file;
+        double nominalRate;
+        double measuredRate;
+        double driftPpm;
+        double ratio;           //output frames per input frame
+        double alignmentError;  //frames behind shared clock, smoothed
+        qint64 framesIn;
+        qint64 framesOut;
+    };
+
+    SyncStream(const QAudioDeviceInfo &device, const QAudioFormat &format, int outputRate, const QString &path);
+    ~SyncStream();
+
+    bool start(QObject *context, const std::function<qint64()> &clock, const std::function<void()> &failed);
+    bool stop();
+    QString error_string() const;
+    Statistics get_statistics() const;
+private:
+    void process(qint64 now);
+    void estimate(qint64 now);
+    void resample(const qint16 *input, qint64 frames, PooledBuffer &output);
+    bool write_output(const PooledBuffer &output);
+    bool write_silence(qint64 frames);
+    qint64 input_limit() const;
+    void fail(const QString &message);
+
+    QAudioDeviceInfo device;
+    QAudioFormat format;
+    std::unique_ptr<QAudioInput> input;
+    QIODevice *source;
+    QFile file;
+    WavFormat wav;
+    QString errorString;
+    std::function<qint64()> clock;
+    std::function<void()> failed;   //called once capture stopped because of an error
+
+    PooledBuffer pending;           //captured bytes, incomplete frame is kept at the start
+    std::vector<qint16> previous;   //last input frame, interpolation start point
+    double phase;
+    double ratio;
+    double nominalRate;
+    double outputRate;
+
+    //exponentially weighted least squares of received frames over time, centered for stability
+    double weight;
+    double meanTime;
+    double meanFrames;
+    double varianceTime;
+    double covariance;
+    double measuredRate;
+    double alignmentError;
+    qint64 framesIn;
+    qint64 framesOut;
+    qint64 firstBuffer;
+
+    static const double FORGETTING;
+    static const double WARMUP_SECONDS;
+    static const double CORRECTION_SECONDS;
+    static const double MAX_CORRECTION;
+};
@@ -0,0 +1,120 @@
+#include "stdafx.h"
+#include "wavformat.hpp"
+#include <cmath>
+#include <cstring>
+
+bool WavFormat::is_supported() const {
+    if (channels == 0 || sampleRate == 0 || blockAlign != channels * (bitsPerSample / 8))
+        return false;
+    if (formatTag == PCM)
+        return bitsPerSample == 8 || bitsPerSample == 16 || bitsPerSample == 24 || bitsPerSample == 32;
+    if (formatTag == FLOAT)
+        return bitsPerSample == 32;
+    return false;
+}
+
+qint64 WavFormat::frames() const {
+    return blockAlign ? dataSize / blockAlign : 0;
+}
+
+double WavFormat::rms(const char *data, qint64 frames) const {
+    const qint64 samples = frames * channels;
+    if (samples <= 0)
+        return 0.0;
+
+    const uchar *bytes = reinterpret_cast<const uchar*>(data);
+    double sum = 0.0;
+    for (qint64 i = 0; i < samples; ++i) {
+        double value;
+        switch (bitsPerSample) {
+        case 8:
+            value = (bytes[i] - 128) / 128.0;
+            break;
+        case 16:
+            value = qFromLittleEndian<qint16>(bytes + 2 * i) / 32768.0;
+            break;
+        case 24: {
+            const uchar *p = bytes + 3 * i;
+            qint32 sample = (p[0] << 8) | (p[1] << 16) | (p[2] << 24);
+            value = (sample >> 8) / 8388608.0;
+            break;
+        }
+        default:
+            if (formatTag == FLOAT) {
+                quint32 bits = qFromLittleEndian<quint32>(bytes + 4 * i);
+                float sample;
+                std::memcpy(&sample, &bits, sizeof(sample));
+                value = sample;
+            } else
+                value = qFromLittleEndian<qint32>(bytes + 4 * i) / 2147483648.0;
+        }
+        sum += value * value;
+    }
+    return std::sqrt(sum / samples);
+}
+
+QByteArray WavFormat::serialize() const {
+    QByteArray header(HEADER_SIZE, '\0');
+    uchar *p = reinterpret_cast<uchar*>(header.data());
+    std::memcpy(p, "RIFF", 4);
+    //saturated size is read back as "up to the end of file", wrapped one would cut the data
+    const qint64 size = std::min(dataSize, MAX_DATA_SIZE);
+    qToLittleEndian(static_cast<quint32>(HEADER_SIZE - 8 + size), p + 4);
+    std::memcpy(p + 8, "WAVEfmt ", 8);
+    qToLittleEndian(quint32(16), p + 16);
+    qToLittleEndian(formatTag, p + 20);
+    qToLittleEndian(channels, p + 22);
+    qToLittleEndian(sampleRate, p + 24);
+    qToLittleEndian(sampleRate * blockAlign, p + 28);
+    qToLittleEndian(blockAlign, p + 32);
+    qToLittleEndian(bitsPerSample, p + 34);
+    std::memcpy(p + 36, "data", 4);
+    qToLittleEndian(static_cast<quint32>(dataSize > MAX_DATA_SIZE ? 0xFFFFFFFFll : size), p + 40);
+    return header;
+}
+
+bool WavFormat::read(QIODevice &device, WavFormat &format) {
+    if (!device.seek(0))
+        return false;
+    QByteArray riff = device.read(12);
+    if (riff.size() != 12 || !riff.startsWith("RIFF") || riff.mid(8, 4) != "WAVE")
+        return false;
+
+    bool hasFormat = false;
+    while (true) {
+        QByteArray header = device.read(8);
+        if (header.size() != 8)
+            return false;
+        quint32 chunkSize = qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(header.constData() + 4));
+        qint64 chunkStart = device.pos();
+
+        if (header.startsWith("fmt ")) {
+            QByteArray fmt = device.read(std::min<qint64>(chunkSize, 40));
+            if (fmt.size() < 16)
+                return false;
+            const uchar *p = reinterpret_cast<const uchar*>(fmt.constData());
+            format.formatTag = qFromLittleEndian<quint16>(p);
+            format.channels = qFromLittleEndian<quint16>(p + 2);
+            format.sampleRate = qFromLittleEndian<quint32>(p + 4);
+            format.blockAlign = qFromLittleEndian<quint16>(p + 12);
+            format.bitsPerSample = qFromLittleEndian<quint16>(p + 14);
+            if (format.formatTag == EXTENSIBLE && fmt.size() >= 26)
+                format.formatTag = qFromLittleEndian<quint16>(p + 24); //first bytes of SubFormat GUID
+            hasFormat = true;
+        } else if (header.startsWith("data")) {
+            if (!hasFormat)
+                return false;
+            format.dataOffset = chunkStart;
+            //recorders that were interrupted leave 0 or 0xFFFFFFFF here
+            qint64 available = device.size() - chunkStart;
+            format.dataSize = (chunkSize == 0 || chunkSize > available) ? available : chunkSize;
+            return true;
+        }
+
+        if (!device.seek(chunkStart + chunkSize + (chunkSize & 1)))
+            return false;
+    }
+}
+
+const int WavFormat::HEADER_SIZE;
+const qint64 WavFormat::MAX_DATA_SIZE = 0xFFFFFFFFll - (WavFormat::HEADER_SIZE - 8);
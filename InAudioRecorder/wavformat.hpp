@@ -0,0 +1,25 @@
+#pragma once
+
+#include <QIODevice>
+
+struct WavFormat {
+    enum : quint16 { PCM = 0x0001, FLOAT = 0x0003, EXTENSIBLE = 0xFFFE };
+
+    quint16 formatTag;
+    quint16 channels;
+    quint32 sampleRate;
+    quint16 blockAlign;
+    quint16 bitsPerSample;
+    qint64 dataOffset;   //position of first sample byte
+    qint64 dataSize;     //clamped to the real file size
+
+    bool is_supported() const;
+    qint64 frames() const;
+    double rms(const char *data, qint64 frames) const;
+    QByteArray serialize() const;   //canonical 44 byte header, sizes above MAX_DATA_SIZE are saturated
+
+    static bool read(QIODevice &device, WavFormat &format);
+
+    static const int HEADER_SIZE = 44;
+    static const qint64 MAX_DATA_SIZE;  //largest data chunk whose RIFF size still fits 32 bits
+};